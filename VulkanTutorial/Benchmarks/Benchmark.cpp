@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fstream>
+#endif
+
+
+uint64_t Benchmark::GetPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return uint64_t(usage.ru_maxrss) * 1024; //kilobytes on linux
+#endif
+}
+
+uint64_t Benchmark::GetResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+#else
+    uint64_t totalPages{ 0 }, residentPages{ 0 };
+    std::ifstream statm{ "/proc/self/statm" };
+    statm >> totalPages >> residentPages;
+    return residentPages * uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+std::vector<std::string> Benchmark::GetInputFiles(const std::vector<std::string>& vArguments, const std::string& directory, const std::string& extension)
+{
+    if (!vArguments.empty())
+        return vArguments;
+
+    std::vector<std::string> vFiles;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == extension)
+            vFiles.push_back(entry.path().generic_string());
+    }
+    std::sort(vFiles.begin(), vFiles.end());
+    return vFiles;
+}
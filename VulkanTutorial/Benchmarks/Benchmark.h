@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+//Headless cpu benchmarks for the loaders, no window and no vulkan device. Run from the VulkanTutorial folder:
+//  Benchmarks obj [files...]           serial tinyobj::LoadObj against the parallel ObjLoader path
+//  Benchmarks dedup map|table [files...] vertex dedup with the old unordered_map or VertexDedupTable,
+//                                        run each in its own process so the peak memory is only theirs
+//  Benchmarks compress [files...]      BC1/BC3/BC5 psnr and speed on synthetic images plus the png textures
+class Benchmark
+{
+public:
+    //fastest off repeats runs, in milliseconds
+    template<typename Job>
+    static double Time(uint32_t repeats, const Job& job)
+    {
+        double best{ 1e30 };
+        for (uint32_t run{}; run < repeats; ++run)
+        {
+            auto startTime = std::chrono::high_resolution_clock::now();
+            job();
+            auto endTime = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(endTime - startTime).count());
+        }
+        return best;
+    }
+
+    //peak working set off this process so far
+    static uint64_t GetPeakResidentBytes();
+    //current working set off this process
+    static uint64_t GetResidentBytes();
+    //the files with that extension in directory, sorted, or the arguments when there are any
+    static std::vector<std::string> GetInputFiles(const std::vector<std::string>& vArguments, const std::string& directory, const std::string& extension);
+
+    static int RunObjLoad(const std::vector<std::string>& vArguments);
+    static int RunDedup(const std::vector<std::string>& vArguments);
+    static int RunCompress(const std::vector<std::string>& vArguments);
+};
@@ -0,0 +1,28 @@
+#include "Benchmark.h"
+#include <iostream>
+#include <exception>
+
+
+int main(int argc, char* argv[])
+{
+    const std::string mode = argc > 1 ? argv[1] : "";
+    const std::vector<std::string> vArguments(argv + std::min(argc, 2), argv + argc);
+
+    try {
+        if (mode == "obj")
+            return Benchmark::RunObjLoad(vArguments);
+        if (mode == "dedup")
+            return Benchmark::RunDedup(vArguments);
+        if (mode == "compress")
+            return Benchmark::RunCompress(vArguments);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "usage: Benchmarks obj [files...]\n"
+        "       Benchmarks dedup map|table [files...]\n"
+        "       Benchmarks compress [files...]\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,128 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "Benchmark.h"
+#include "MipBuilder.h"
+#include "TextureCompressor.h"
+#include <stb_image.h>
+#include <cmath>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+
+//one rgba8 image to compress, isSrgb/isTwoChannel as TextureLoader would pick them
+struct BenchmarkImage
+{
+    std::string name;
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    bool isSrgb{ true };
+    bool isTwoChannel{ false };
+    std::vector<uint8_t> vPixels;
+};
+
+static uint8_t toByte(float value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+//smooth color gradients with a little noise on top, like a photo. isAlpha adds a horizontal alpha ramp (BC3)
+static BenchmarkImage buildColorImage(uint32_t side, bool isAlpha)
+{
+    BenchmarkImage image{ isAlpha ? "synthetic alpha" : "synthetic color", side, side, true, false, {} };
+    image.vPixels.resize(size_t(side) * side * 4);
+    uint32_t noise{ 1234 };
+    for (uint32_t y{}; y < side; ++y)
+        for (uint32_t x{}; x < side; ++x)
+        {
+            const float u = float(x) / side, v = float(y) / side;
+            noise = noise * 1664525u + 1013904223u;
+            const float grain = float(noise >> 24) / 255.0f * 0.06f - 0.03f;
+            uint8_t* pTexel = &image.vPixels[(size_t(y) * side + x) * 4];
+            pTexel[0] = toByte(0.5f + 0.5f * std::sin(u * 9.0f) + grain);
+            pTexel[1] = toByte(v + grain);
+            pTexel[2] = toByte(0.5f + 0.5f * std::cos((u + v) * 5.0f) + grain);
+            pTexel[3] = isAlpha ? toByte(u) : 255;
+        }
+    return image;
+}
+
+//tangent space normals off a bumpy height field, only red and green matter (BC5)
+static BenchmarkImage buildNormalImage(uint32_t side)
+{
+    BenchmarkImage image{ "synthetic normal map", side, side, false, true, {} };
+    image.vPixels.resize(size_t(side) * side * 4);
+    for (uint32_t y{}; y < side; ++y)
+        for (uint32_t x{}; x < side; ++x)
+        {
+            const float u = float(x) / side * 40.0f, v = float(y) / side * 40.0f;
+            const float dx = 0.6f * std::cos(u) * std::sin(v), dy = 0.6f * std::sin(u) * std::cos(v);
+            const float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+            uint8_t* pTexel = &image.vPixels[(size_t(y) * side + x) * 4];
+            pTexel[0] = toByte(-dx / length * 0.5f + 0.5f);
+            pTexel[1] = toByte(-dy / length * 0.5f + 0.5f);
+            pTexel[2] = toByte(1.0f / length * 0.5f + 0.5f);
+            pTexel[3] = 255;
+        }
+    return image;
+}
+
+static const char* getFormatName(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:  return "BC1 srgb";
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return "BC1";
+    case VK_FORMAT_BC3_SRGB_BLOCK:      return "BC3 srgb";
+    case VK_FORMAT_BC3_UNORM_BLOCK:     return "BC3";
+    case VK_FORMAT_BC5_UNORM_BLOCK:     return "BC5";
+    default:                            return "?";
+    }
+}
+
+int Benchmark::RunCompress(const std::vector<std::string>& vArguments)
+{
+    std::vector<BenchmarkImage> vImages;
+    vImages.push_back(buildColorImage(1024, false));
+    vImages.push_back(buildColorImage(1024, true));
+    vImages.push_back(buildNormalImage(1024));
+    for (const std::string& file : GetInputFiles(vArguments, "textures", ".png"))
+    {
+        int width{}, height{}, channels{};
+        stbi_uc* pPixels = stbi_load(file.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pPixels)
+        {
+            std::cout << file << ": stbi_load failed, skipped\n";
+            continue;
+        }
+        BenchmarkImage image{ file, uint32_t(width), uint32_t(height), true, false, {} };
+        image.vPixels.assign(pPixels, pPixels + size_t(width) * height * 4);
+        stbi_image_free(pPixels);
+        vImages.push_back(std::move(image));
+    }
+
+    //MP/s over the whole mip chain, best off 3 runs, once on one thread and once on all off them
+    const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t repeats{ 3 };
+    std::cout << std::fixed << std::setprecision(2);
+    for (const BenchmarkImage& image : vImages)
+    {
+        std::vector<TextureCacheMip> vMips, vBlockMips;
+        std::vector<uint8_t> vMipPixels, vBlockPixels;
+        MipBuilder::Build(image.vPixels.data(), image.width, image.height, image.isSrgb, vMips, vMipPixels);
+        const VkFormat format = TextureCompressor::SelectFormat(image.vPixels.data(), image.width, image.height, image.isSrgb, image.isTwoChannel);
+
+        CompressionStats stats{};
+        double singleSpeed{ 0.0 }, threadedSpeed{ 0.0 };
+        for (uint32_t run{}; run < repeats; ++run)
+        {
+            stats = TextureCompressor::Compress(format, vMips, vMipPixels, vBlockMips, vBlockPixels, 1);
+            singleSpeed = std::max(singleSpeed, stats.megapixelsPerSecond);
+            threadedSpeed = std::max(threadedSpeed, TextureCompressor::Compress(format, vMips, vMipPixels, vBlockMips, vBlockPixels, hardwareThreads).megapixelsPerSecond);
+        }
+
+        std::cout << image.name << " " << image.width << "x" << image.height << " " << getFormatName(format) << ": "
+            << stats.sourceBytes / 1024 << "KB -> " << stats.compressedBytes / 1024 << "KB | " << stats.psnr << "dB psnr | "
+            << singleSpeed << " MP/s on 1 thread, " << threadedSpeed << " MP/s on " << hardwareThreads << "\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#define GLM_ENABLE_EXPERIMENTAL //for hash mapping
+#include "Benchmark.h"
+#include "ObjLoader.h"
+#include "VertexDedupTable.h"
+#include "Tests/TestMeshes.h"
+#include <glm/gtx/hash.hpp>
+#include <unordered_map>
+#include <iostream>
+#include <iomanip>
+
+
+//the std::hash<Vertex3D> Structs.h had before VertexDedupTable replaced the map
+struct MapVertexHash
+{
+    size_t operator()(Vertex3D const& vertex) const {
+        return ((std::hash<glm::vec3>()(vertex.pos) ^
+            (std::hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
+            (std::hash<glm::vec2>()(vertex.texcoord) << 1);
+    }
+};
+
+//one vertex per triangle corner, in file order
+static bool loadCorners(const std::string& path, std::vector<Vertex3D>& corners)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warningMessage, errorMessage;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warningMessage, &errorMessage, path.c_str(), ObjLoader::GetMaterialBaseDir(path).c_str()))
+        return false;
+
+    for (const auto& shape : shapes)
+        for (const auto& index : shape.mesh.indices)
+            corners.push_back(ObjLoader::BuildVertex(attrib, index, true));
+    return true;
+}
+
+int Benchmark::RunDedup(const std::vector<std::string>& vArguments)
+{
+    const std::string variant = vArguments.empty() ? "" : vArguments[0];
+    if (variant != "map" && variant != "table")
+    {
+        std::cerr << "dedup needs map or table\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Vertex3D> corners;
+    const std::vector<std::string> vFiles = GetInputFiles({ vArguments.begin() + 1, vArguments.end() }, "tinyobjloader-release/models", ".obj");
+    for (const std::string& file : vFiles)
+    {
+        if (!loadCorners(file, corners))
+            std::cout << file << ": tinyobj::LoadObj failed, skipped\n";
+    }
+    if (corners.empty())
+    {
+        std::cout << "no obj files found, using a shuffled 1500x1500 grid\n";
+        corners = TestMeshes::BuildShuffledGridCorners(1500);
+    }
+
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices(corners.size()); //resized instead off reserved so its pages are already in the working set
+
+    //everything the dedup does not own is allocated by now, whatever the working set grows by from here is the map or table
+    const uint64_t residentBefore = GetResidentBytes();
+    uint64_t residentAfter{ 0 };
+    auto startTime = std::chrono::high_resolution_clock::now();
+    if (variant == "map")
+    {
+        std::unordered_map<Vertex3D, uint32_t, MapVertexHash> mUniqueVertexes{};
+        for (size_t corner{}; corner < corners.size(); ++corner)
+        {
+            const Vertex3D& vertex = corners[corner];
+            if (mUniqueVertexes.count(vertex) == 0)
+            {
+                mUniqueVertexes[vertex] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+            indices[corner] = mUniqueVertexes[vertex];
+        }
+        residentAfter = GetResidentBytes();
+    }
+    else
+    {
+        VertexDedupTable uniqueVertices{ corners.size() };
+        for (size_t corner{}; corner < corners.size(); ++corner)
+            indices[corner] = uniqueVertices.Insert(corners[corner], vertices);
+        residentAfter = GetResidentBytes();
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    //same checksum for both variants means the same vertices in the same order
+    uint64_t checksum{ 14695981039346656037ull };
+    for (uint32_t index : indices)
+        checksum = (checksum ^ index) * 1099511628211ull;
+
+    std::cout << std::fixed << std::setprecision(2)
+        << variant << ": " << corners.size() << " corners -> " << vertices.size() << " vertices in "
+        << std::chrono::duration<double, std::milli>(endTime - startTime).count() << "ms | working set +"
+        << (residentAfter - std::min(residentAfter, residentBefore)) / (1024.0 * 1024.0) << " MB, peak "
+        << GetPeakResidentBytes() / (1024.0 * 1024.0) << " MB | index checksum " << std::hex << checksum << "\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "Benchmark.h"
+#include "ObjLoader.h"
+#include "VertexDedupTable.h"
+#include <iostream>
+#include <iomanip>
+
+
+//the same vertex building and dedup Mesh::loadBuffered runs after the parse
+static void buildMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, bool isColored,
+    std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices)
+{
+    size_t totalIndices{ 0 };
+    for (const auto& shape : shapes)
+        totalIndices += shape.mesh.indices.size();
+
+    vertices.clear();
+    indices.clear();
+    indices.reserve(totalIndices);
+    VertexDedupTable uniqueVertices{ totalIndices };
+    for (const auto& shape : shapes)
+        for (const auto& index : shape.mesh.indices)
+            indices.push_back(uniqueVertices.Insert(ObjLoader::BuildVertex(attrib, index, isColored), vertices));
+}
+
+int Benchmark::RunObjLoad(const std::vector<std::string>& vArguments)
+{
+    const std::vector<std::string> vFiles = GetInputFiles(vArguments, "tinyobjloader-release/models", ".obj");
+    if (vFiles.empty())
+    {
+        std::cerr << "no obj files found\n";
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t repeats{ 3 };
+    int mismatches{ 0 };
+    std::cout << std::fixed << std::setprecision(2);
+    for (const std::string& file : vFiles)
+    {
+        tinyobj::attrib_t serialAttrib, parallelAttrib;
+        std::vector<tinyobj::shape_t> vSerialShapes, vParallelShapes;
+        std::vector<tinyobj::material_t> vMaterials;
+        std::string warningMessage, errorMessage;
+        const std::string materialBaseDir = ObjLoader::GetMaterialBaseDir(file);
+
+        bool isSerialLoaded{ false };
+        const double serialParse = Time(repeats, [&]()
+            {
+                serialAttrib = {};
+                vSerialShapes.clear();
+                vMaterials.clear();
+                isSerialLoaded = tinyobj::LoadObj(&serialAttrib, &vSerialShapes, &vMaterials, &warningMessage, &errorMessage, file.c_str(), materialBaseDir.c_str());
+            });
+        if (!isSerialLoaded)
+        {
+            std::cout << file << ": tinyobj::LoadObj failed, skipped\n";
+            continue;
+        }
+
+        bool isParallelLoaded{ false };
+        const double parallelParse = Time(repeats, [&]()
+            {
+                parallelAttrib = {};
+                vParallelShapes.clear();
+                isParallelLoaded = ObjLoader::LoadParallel(file, -1, parallelAttrib, vParallelShapes, errorMessage);
+            });
+
+        //the models off the tinyobj test set do not all have uvs, the app meshes always get built colored
+        const bool isColored = !serialAttrib.texcoords.empty();
+        std::vector<Vertex3D> vSerialVertices, vParallelVertices;
+        std::vector<uint32_t> vSerialIndices, vParallelIndices;
+        const double serialBuild = Time(repeats, [&]() { buildMesh(serialAttrib, vSerialShapes, isColored, vSerialVertices, vSerialIndices); });
+
+        std::cout << file << ": " << vSerialVertices.size() << " vertices, " << vSerialIndices.size() << " indices | serial parse "
+            << serialParse << "ms build " << serialBuild << "ms | ";
+        if (!isParallelLoaded)
+        {
+            std::cout << "parallel n/a (" << errorMessage << "), the load falls back to serial\n";
+            continue;
+        }
+
+        const double parallelBuild = Time(repeats, [&]() { buildMesh(parallelAttrib, vParallelShapes, isColored, vParallelVertices, vParallelIndices); });
+        const bool isIdentical = vSerialVertices == vParallelVertices && vSerialIndices == vParallelIndices;
+        mismatches += isIdentical ? 0 : 1;
+        std::cout << "parallel parse " << parallelParse << "ms build " << parallelBuild << "ms | parse speedup "
+            << serialParse / std::max(parallelParse, 1e-6) << "x | " << (isIdentical ? "identical" : "MISMATCH") << "\n";
+    }
+
+    std::cout << "peak resident memory " << GetPeakResidentBytes() / (1024.0 * 1024.0) << " MB\n";
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
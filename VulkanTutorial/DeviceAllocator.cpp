@@ -0,0 +1,478 @@
+#include "DeviceAllocator.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+
+DeviceAllocator::DeviceAllocator(VkPhysicalDevice physicalDevice, VkDevice logicDevice, bool hasMemoryBudget)
+    : m_LogicalDevice{ logicDevice }, m_PhysicalDevice{ physicalDevice }, m_HasMemoryBudget{ hasMemoryBudget }
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_BufferImageGranularity = std::max<VkDeviceSize>(1, properties.limits.bufferImageGranularity);
+
+    //host visible blocks get mapped once for their whole lifetime, a VkDeviceMemory can only be mapped once
+    m_Callbacks.allocate = [this](uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& pMapped)
+        {
+            VkMemoryAllocateInfo allocateInfo{};
+            allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocateInfo.allocationSize  = size;
+            allocateInfo.memoryTypeIndex = memoryType;
+
+            VkResult result = vkAllocateMemory(m_LogicalDevice, &allocateInfo, nullptr, &memory);
+            if (result != VK_SUCCESS)
+                return result;
+
+            pMapped = nullptr;
+            if (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            {
+                result = vkMapMemory(m_LogicalDevice, memory, 0, VK_WHOLE_SIZE, 0, &pMapped);
+                if (result != VK_SUCCESS)
+                    vkFreeMemory(m_LogicalDevice, memory, nullptr);
+            }
+            return result;
+        };
+    m_Callbacks.free = [this](VkDeviceMemory memory)
+        {
+            vkFreeMemory(m_LogicalDevice, memory, nullptr); //also unmaps
+        };
+}
+
+DeviceAllocator::DeviceAllocator(const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize bufferImageGranularity, const BlockCallbacks& callbacks)
+    : m_MemoryProperties{ memoryProperties }, m_BufferImageGranularity{ std::max<VkDeviceSize>(1, bufferImageGranularity) }, m_Callbacks{ callbacks }
+{
+}
+
+DeviceAllocator::~DeviceAllocator()
+{
+    for (auto& block : m_Blocks)
+        m_Callbacks.free(block.second.memory);
+}
+
+DeviceAllocation DeviceAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, MemoryCategory category)
+{
+    const uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, properties);
+
+    //optimal images own every granularity page they touch, so no linear resource can end up next to them on one
+    VkDeviceSize alignment = std::max<VkDeviceSize>(1, requirements.alignment);
+    VkDeviceSize size = requirements.size;
+    if (kind == ResourceKind::OptimalImage)
+    {
+        alignment = std::max(alignment, m_BufferImageGranularity);
+        size      = alignUp(size, m_BufferImageGranularity);
+    }
+
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    uint64_t blockId{ 0 };
+    VkDeviceSize offset{ 0 };
+    const VkDeviceSize blockSize = GetBlockSize(memoryType);
+    const bool isLazy = (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+    if (size > blockSize / 2 || isLazy)
+    {
+        //would waste most off a shared block, gets its own
+        //(lazily allocated memory gets committed per VkDeviceMemory, so every transient attachment keeps its own)
+        blockId = createBlock(memoryType, size, true);
+    }
+    else
+    {
+        for (uint64_t id : m_vBlockIds[memoryType])
+        {
+            if (AllocateRange(m_Blocks[id].vFreeRanges, size, alignment, offset))
+            {
+                blockId = id;
+                break;
+            }
+        }
+
+        if (blockId == 0)
+        {
+            blockId = createBlock(memoryType, blockSize, false);
+            AllocateRange(m_Blocks[blockId].vFreeRanges, size, alignment, offset);
+        }
+    }
+
+    MemoryBlock& block = m_Blocks[blockId];
+    ++block.allocationCount;
+    block.usedBytes += size;
+    m_CategoryBytes[static_cast<size_t>(category)] += size;
+
+    DeviceAllocation allocation{};
+    allocation.memory     = block.memory;
+    allocation.offset     = offset;
+    allocation.size       = size;
+    allocation.pMapped    = block.pMapped ? block.pMapped + offset : nullptr;
+    allocation.memoryType = memoryType;
+    allocation.blockId    = blockId;
+    allocation.category   = category;
+    return allocation;
+}
+
+void DeviceAllocator::Free(DeviceAllocation& allocation)
+{
+    if (allocation.blockId == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    auto it = m_Blocks.find(allocation.blockId);
+    if (it == m_Blocks.end())
+        throw std::runtime_error("freed an allocation that does not belong to this allocator");
+
+    MemoryBlock& block = it->second;
+    --block.allocationCount;
+    block.usedBytes -= allocation.size;
+    m_CategoryBytes[static_cast<size_t>(allocation.category)] -= allocation.size;
+    if (block.isDedicated)
+    {
+        destroyBlock(allocation.blockId);
+    }
+    else
+    {
+        ReleaseRange(block.vFreeRanges, allocation.offset, allocation.size);
+
+        //keep one empty block per type around so a free + allocate does not go back to the driver every time
+        const std::vector<uint64_t>& vIds = m_vBlockIds[block.memoryType];
+        if (block.allocationCount == 0 && vIds.size() > 1)
+            destroyBlock(allocation.blockId);
+    }
+
+    allocation = DeviceAllocation{};
+}
+
+void DeviceAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, DeviceAllocation& allocation,
+    MemoryCategory category)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = size;
+    bufferInfo.usage       = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; //only used by graphicsqueue so exlusive is enough
+
+    if (vkCreateBuffer(m_LogicalDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+        throw std::runtime_error("creation off buffer failed");
+
+    VkMemoryRequirements memRequirements{};
+    vkGetBufferMemoryRequirements(m_LogicalDevice, buffer, &memRequirements);
+
+    allocation = Allocate(memRequirements, properties, ResourceKind::Linear, category);
+    vkBindBufferMemory(m_LogicalDevice, buffer, allocation.memory, allocation.offset);
+}
+
+void DeviceAllocator::CreateImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, DeviceAllocation& allocation,
+    MemoryCategory category)
+{
+    if (vkCreateImage(m_LogicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        throw std::runtime_error{ "failed to create image" };
+
+    VkMemoryRequirements memRequirements{};
+    vkGetImageMemoryRequirements(m_LogicalDevice, image, &memRequirements);
+
+    if ((properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !HasMemoryType(memRequirements.memoryTypeBits, properties))
+        properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT; //most desktop gpus have none
+
+    allocation = Allocate(memRequirements, properties, imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::OptimalImage : ResourceKind::Linear, category);
+    vkBindImageMemory(m_LogicalDevice, image, allocation.memory, allocation.offset);
+}
+
+void DeviceAllocator::DestroyBuffer(VkBuffer& buffer, DeviceAllocation& allocation)
+{
+    vkDestroyBuffer(m_LogicalDevice, buffer, nullptr);
+    buffer = VK_NULL_HANDLE;
+    Free(allocation);
+}
+
+void DeviceAllocator::DestroyImage(VkImage& image, DeviceAllocation& allocation)
+{
+    vkDestroyImage(m_LogicalDevice, image, nullptr);
+    image = VK_NULL_HANDLE;
+    Free(allocation);
+}
+
+DeviceAllocatorStats DeviceAllocator::GetStats()const
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    DeviceAllocatorStats stats{};
+    for (const auto& entry : m_Blocks)
+    {
+        const MemoryBlock& block = entry.second;
+        ++stats.blockCount;
+        if (block.isDedicated)
+            ++stats.dedicatedBlockCount;
+        stats.allocationCount += block.allocationCount;
+        stats.blockBytes      += block.size;
+        stats.usedBytes       += block.usedBytes;
+        for (const FreeRange& range : block.vFreeRanges)
+        {
+            stats.freeBytes        += range.size;
+            stats.largestFreeRange  = std::max(stats.largestFreeRange, range.size);
+        }
+    }
+    if (stats.freeBytes > 0)
+        stats.fragmentation = 1.f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(stats.freeBytes);
+    return stats;
+}
+
+MemoryBudget DeviceAllocator::GetBudget()const
+{
+    MemoryBudget budget{};
+    budget.vHeaps.resize(m_MemoryProperties.memoryHeapCount);
+    for (uint32_t heap{}; heap < m_MemoryProperties.memoryHeapCount; ++heap)
+    {
+        budget.vHeaps[heap].size          = m_MemoryProperties.memoryHeaps[heap].size;
+        budget.vHeaps[heap].isDeviceLocal = (m_MemoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    if (m_HasMemoryBudget && m_PhysicalDevice != VK_NULL_HANDLE)
+    {
+        //the driver numbers also count the swapchain, other allocators in the process and what the driver keeps for itself
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT driverBudget{};
+        driverBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &driverBudget;
+        vkGetPhysicalDeviceMemoryProperties2(m_PhysicalDevice, &properties);
+
+        budget.hasDriverBudget = true;
+        for (uint32_t heap{}; heap < m_MemoryProperties.memoryHeapCount; ++heap)
+        {
+            budget.vHeaps[heap].driverUsage  = driverBudget.heapUsage[heap];
+            budget.vHeaps[heap].driverBudget = driverBudget.heapBudget[heap];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    for (const auto& entry : m_Blocks)
+    {
+        MemoryHeapUsage& heap = budget.vHeaps[m_MemoryProperties.memoryTypes[entry.second.memoryType].heapIndex];
+        heap.blockBytes += entry.second.size;
+        heap.usedBytes  += entry.second.usedBytes;
+    }
+    for (size_t category{}; category < static_cast<size_t>(MemoryCategory::Count); ++category)
+        budget.categoryBytes[category] = m_CategoryBytes[category];
+    for (const MemoryHeapUsage& heap : budget.vHeaps)
+    {
+        if (heap.isDeviceLocal)
+            budget.deviceLocalUsage += budget.hasDriverBudget ? heap.driverUsage : heap.blockBytes;
+    }
+    return budget;
+}
+
+const char* DeviceAllocator::GetCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::Mesh:       return "mesh";
+    case MemoryCategory::Texture:    return "texture";
+    case MemoryCategory::Uniform:    return "uniform";
+    case MemoryCategory::Attachment: return "attachment";
+    case MemoryCategory::Staging:    return "staging";
+    default:                         return "other";
+    }
+}
+
+bool DeviceAllocator::EnforceSoftBudget()
+{
+    if (m_SoftBudget == 0)
+        return false;
+
+    //the only budget query this frame (the driver one is not free), the blocks this allocator
+    //gives back or takes after it move the usage by their size
+    const VkDeviceSize queriedUsage = GetBudget().deviceLocalUsage;
+    if (queriedUsage <= m_SoftBudget)
+        return false;
+
+    VkDeviceSize queriedBlockBytes{ 0 };
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        queriedBlockBytes = m_DeviceLocalBlockBytes;
+        releaseEmptyBlocks();
+    }
+    auto getUsage = [&]()
+        {
+            std::lock_guard<std::mutex> lock{ m_Mutex };
+            const VkDeviceSize usage = queriedUsage + m_DeviceLocalBlockBytes;
+            return usage > queriedBlockBytes ? usage - queriedBlockBytes : 0;
+        };
+    VkDeviceSize usage = getUsage();
+
+    //outside the lock, the callbacks free through this allocator
+    for (const EvictionCallback& callback : m_vEvictionCallbacks)
+    {
+        if (usage <= m_SoftBudget)
+            break;
+        callback(usage - m_SoftBudget);
+        usage = getUsage();
+    }
+    return usage > m_SoftBudget;
+}
+
+uint32_t DeviceAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)const
+{
+    const uint32_t memoryType = findMemoryType(typeFilter, properties);
+    if (memoryType == UINT32_MAX)
+        throw std::runtime_error("failed to find suitable memory type");
+    return memoryType;
+}
+
+bool DeviceAllocator::HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)const
+{
+    return findMemoryType(typeFilter, properties) != UINT32_MAX;
+}
+
+bool DeviceAllocator::IsLazilyAllocated(const DeviceAllocation& allocation)const
+{
+    return allocation.blockId != 0 && (m_MemoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+}
+
+VkDeviceSize DeviceAllocator::GetCommittedBytes(const DeviceAllocation& allocation)const
+{
+    if (!IsLazilyAllocated(allocation) || m_LogicalDevice == VK_NULL_HANDLE)
+        return allocation.size;
+
+    VkDeviceSize committedBytes{ 0 };
+    vkGetDeviceMemoryCommitment(m_LogicalDevice, allocation.memory, &committedBytes);
+    return committedBytes;
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)const
+{
+    for (uint32_t i{}; i < m_MemoryProperties.memoryTypeCount; ++i)
+    {
+        if (typeFilter & (1 << i) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+bool DeviceAllocator::isDeviceLocalHeap(uint32_t memoryType)const
+{
+    return (m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType].heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+}
+
+VkDeviceSize DeviceAllocator::GetBlockSize(uint32_t memoryType)const
+{
+    //small heaps (bar memory, integrated gpus with little carve out) would be eaten by a few big blocks
+    const VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return std::min(m_DefaultBlockSize, std::max<VkDeviceSize>(heapSize / 8, 1));
+}
+
+uint64_t DeviceAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool isDedicated)
+{
+    MemoryBlock block{};
+    void* pMapped{ nullptr };
+    if (m_Callbacks.allocate(memoryType, size, block.memory, pMapped) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate device memory block");
+
+    block.size        = size;
+    block.pMapped     = static_cast<uint8_t*>(pMapped);
+    block.memoryType  = memoryType;
+    block.isDedicated = isDedicated;
+    if (!isDedicated)
+        block.vFreeRanges.push_back(FreeRange{ 0, size });
+
+    if (isDeviceLocalHeap(memoryType))
+        m_DeviceLocalBlockBytes += size;
+
+    const uint64_t blockId = m_NextBlockId++;
+    m_Blocks.emplace(blockId, std::move(block));
+    if (!isDedicated)
+        m_vBlockIds[memoryType].push_back(blockId);
+    return blockId;
+}
+
+void DeviceAllocator::destroyBlock(uint64_t blockId)
+{
+    auto it = m_Blocks.find(blockId);
+    std::vector<uint64_t>& vIds = m_vBlockIds[it->second.memoryType];
+    vIds.erase(std::remove(vIds.begin(), vIds.end(), blockId), vIds.end());
+
+    if (isDeviceLocalHeap(it->second.memoryType))
+        m_DeviceLocalBlockBytes -= it->second.size;
+
+    m_Callbacks.free(it->second.memory);
+    m_Blocks.erase(it);
+}
+
+void DeviceAllocator::releaseEmptyBlocks()
+{
+    std::vector<uint64_t> vEmptyIds;
+    for (const auto& entry : m_Blocks)
+    {
+        if (!entry.second.isDedicated && entry.second.allocationCount == 0)
+            vEmptyIds.push_back(entry.first);
+    }
+    for (uint64_t blockId : vEmptyIds)
+        destroyBlock(blockId);
+}
+
+bool DeviceAllocator::AllocateRange(std::vector<FreeRange>& vFreeRanges, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    //best fit: the range that has the least left over after alignment
+    size_t bestRange{ SIZE_MAX };
+    VkDeviceSize bestLeftOver{ 0 };
+    for (size_t range{}; range < vFreeRanges.size(); ++range)
+    {
+        const FreeRange& freeRange = vFreeRanges[range];
+        const VkDeviceSize alignedOffset = alignUp(freeRange.offset, alignment);
+        const VkDeviceSize end = alignedOffset + size;
+        if (end > freeRange.offset + freeRange.size)
+            continue;
+
+        const VkDeviceSize leftOver = freeRange.size - size;
+        if (bestRange == SIZE_MAX || leftOver < bestLeftOver)
+        {
+            bestRange    = range;
+            bestLeftOver = leftOver;
+        }
+    }
+    if (bestRange == SIZE_MAX)
+        return false;
+
+    //the padding in front and the rest behind stay free
+    const FreeRange freeRange = vFreeRanges[bestRange];
+    offset = alignUp(freeRange.offset, alignment);
+    const VkDeviceSize frontSize = offset - freeRange.offset;
+    const VkDeviceSize backSize  = freeRange.offset + freeRange.size - (offset + size);
+
+    vFreeRanges.erase(vFreeRanges.begin() + bestRange);
+    if (backSize > 0)
+        vFreeRanges.insert(vFreeRanges.begin() + bestRange, FreeRange{ offset + size, backSize });
+    if (frontSize > 0)
+        vFreeRanges.insert(vFreeRanges.begin() + bestRange, FreeRange{ freeRange.offset, frontSize });
+    return true;
+}
+
+void DeviceAllocator::ReleaseRange(std::vector<FreeRange>& vFreeRanges, VkDeviceSize offset, VkDeviceSize size)
+{
+    auto next = std::lower_bound(vFreeRanges.begin(), vFreeRanges.end(), offset,
+        [](const FreeRange& range, VkDeviceSize value) { return range.offset < value; });
+    auto it = vFreeRanges.insert(next, FreeRange{ offset, size });
+
+    //merge with the range behind and the one in front
+    auto after = it + 1;
+    if (after != vFreeRanges.end() && it->offset + it->size == after->offset)
+    {
+        it->size += after->size;
+        vFreeRanges.erase(after);
+    }
+    if (it != vFreeRanges.begin())
+    {
+        auto before = it - 1;
+        if (before->offset + before->size == it->offset)
+        {
+            before->size += it->size;
+            vFreeRanges.erase(it);
+        }
+    }
+}
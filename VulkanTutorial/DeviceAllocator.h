@@ -0,0 +1,178 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+//what the memory is used for, the budget breaks the usage down by it
+enum class MemoryCategory
+{
+    Mesh,
+    Texture,
+    Uniform,
+    Attachment,
+    Staging,
+    Other,
+    Count
+};
+
+//piece off a memory block handed out by DeviceAllocator, bind the resource at memory + offset
+struct DeviceAllocation
+{
+    VkDeviceMemory memory{ VK_NULL_HANDLE };
+    VkDeviceSize offset{ 0 };
+    VkDeviceSize size{ 0 };
+    void* pMapped{ nullptr }; //host visible memory stays mapped, this already points at offset
+    uint32_t memoryType{ UINT32_MAX };
+    uint64_t blockId{ 0 };    //0 = nothing allocated
+    MemoryCategory category{ MemoryCategory::Other };
+};
+
+struct DeviceAllocatorStats
+{
+    uint32_t blockCount{ 0 };
+    uint32_t dedicatedBlockCount{ 0 }; //allocations too big to share a block
+    uint32_t allocationCount{ 0 };
+    VkDeviceSize blockBytes{ 0 };      //everything taken from vkAllocateMemory
+    VkDeviceSize usedBytes{ 0 };
+    VkDeviceSize freeBytes{ 0 };
+    VkDeviceSize largestFreeRange{ 0 };
+    float fragmentation{ 0.f };        //1 - largest free range / free bytes, 0 when the free space is in one piece
+};
+
+struct MemoryHeapUsage
+{
+    VkDeviceSize size{ 0 };
+    VkDeviceSize blockBytes{ 0 };   //taken from this heap by the allocator
+    VkDeviceSize usedBytes{ 0 };    //handed out off those blocks
+    VkDeviceSize driverUsage{ 0 };  //the whole process as the driver sees it, 0 without VK_EXT_memory_budget
+    VkDeviceSize driverBudget{ 0 }; //what the process can have before it starts to hurt, 0 without VK_EXT_memory_budget
+    bool isDeviceLocal{ false };
+};
+
+struct MemoryBudget
+{
+    VkDeviceSize categoryBytes[static_cast<size_t>(MemoryCategory::Count)]{};
+    std::vector<MemoryHeapUsage> vHeaps; //one per memory heap
+    bool hasDriverBudget{ false };
+    VkDeviceSize deviceLocalUsage{ 0 };  //device local heaps, driver usage when known otherwise the block bytes. The soft budget checks this
+};
+
+//free space inside a block, kept sorted by offset
+struct FreeRange
+{
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+//what gets placed in memory, optimal tiled images can not share a bufferImageGranularity page with linear resources
+enum class ResourceKind
+{
+    Linear,      //buffers and linear tiled images
+    OptimalImage
+};
+
+//Sub-allocates buffers and images out off large vkAllocateMemory blocks per memory type,
+//best fit over a free list per block that merges neighbouring ranges again when they get freed
+class DeviceAllocator
+{
+public:
+    //how whole blocks are taken from and given back to the device, swapped out to run the allocator without a gpu
+    struct BlockCallbacks
+    {
+        std::function<VkResult(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& pMapped)> allocate;
+        std::function<void(VkDeviceMemory memory)> free;
+    };
+
+    //called with how far the usage is over the soft budget, free whatever can go
+    using EvictionCallback = std::function<void(VkDeviceSize bytesOverBudget)>;
+
+    //hasMemoryBudget: VK_EXT_memory_budget is enabled on the device, GetBudget then also reports the driver numbers
+    DeviceAllocator(VkPhysicalDevice physicalDevice, VkDevice logicDevice, bool hasMemoryBudget = false);
+    //no vulkan calls are made through this one, only through the callbacks (CreateBuffer/CreateImage need the device)
+    DeviceAllocator(const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize bufferImageGranularity, const BlockCallbacks& callbacks);
+    ~DeviceAllocator();
+
+    DeviceAllocator(const DeviceAllocator&) = delete;
+    DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+    //throws when there is no fitting memory type or the device is out off memory
+    DeviceAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, MemoryCategory category);
+    //resets allocation, freeing an empty allocation does nothing
+    void Free(DeviceAllocation& allocation);
+
+    //create the resource, allocate and bind in one go
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, DeviceAllocation& allocation,
+        MemoryCategory category);
+    //LAZILY_ALLOCATED in properties is a preference for transient attachments, it gets dropped when the image can not have such memory
+    void CreateImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, DeviceAllocation& allocation,
+        MemoryCategory category);
+    void DestroyBuffer(VkBuffer& buffer, DeviceAllocation& allocation);
+    void DestroyImage(VkImage& image, DeviceAllocation& allocation);
+
+    DeviceAllocatorStats GetStats()const;
+    MemoryBudget GetBudget()const;
+    static const char* GetCategoryName(MemoryCategory category);
+
+    //0 turns it off
+    void SetSoftBudget(VkDeviceSize bytes) { m_SoftBudget = bytes; };
+    VkDeviceSize GetSoftBudget()const { return m_SoftBudget; };
+    void AddEvictionCallback(const EvictionCallback& callback) { m_vEvictionCallbacks.push_back(callback); };
+    //call once per frame outside off any allocation. Over the soft budget the cached empty blocks go back first,
+    //then the eviction callbacks get called. Returns true while still over.
+    //The budget is queried once, what gets freed after that is taken off it locally
+    bool EnforceSoftBudget();
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)const;
+    bool HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)const;
+    bool IsLazilyAllocated(const DeviceAllocation& allocation)const;
+    //what the driver actually backs with memory, less than the size only for lazily allocated memory
+    VkDeviceSize GetCommittedBytes(const DeviceAllocation& allocation)const;
+    VkDeviceSize GetBlockSize(uint32_t memoryType)const;
+
+    //best fit out off a sorted free list, the alignment padding stays free. Also places meshes inside the MeshArena buffers
+    static bool AllocateRange(std::vector<FreeRange>& vFreeRanges, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    //puts the range back and merges it with its neighbours
+    static void ReleaseRange(std::vector<FreeRange>& vFreeRanges, VkDeviceSize offset, VkDeviceSize size);
+
+private:
+
+    struct MemoryBlock
+    {
+        VkDeviceMemory memory{ VK_NULL_HANDLE };
+        VkDeviceSize size{ 0 };
+        uint8_t* pMapped{ nullptr };
+        uint32_t memoryType{ 0 };
+        bool isDedicated{ false };
+        uint32_t allocationCount{ 0 };
+        VkDeviceSize usedBytes{ 0 };
+        std::vector<FreeRange> vFreeRanges; //sorted by offset, neighbours are always merged
+    };
+
+    static constexpr VkDeviceSize m_DefaultBlockSize{ 64ull << 20 };
+
+    VkDevice m_LogicalDevice{ VK_NULL_HANDLE };
+    VkPhysicalDevice m_PhysicalDevice{ VK_NULL_HANDLE };
+    bool m_HasMemoryBudget{ false };
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+    VkDeviceSize m_BufferImageGranularity{ 1 };
+    BlockCallbacks m_Callbacks;
+
+    std::unordered_map<uint64_t, MemoryBlock> m_Blocks;
+    std::vector<uint64_t> m_vBlockIds[VK_MAX_MEMORY_TYPES]; //shared blocks per memory type, in creation order
+    uint64_t m_NextBlockId{ 1 };
+    VkDeviceSize m_CategoryBytes[static_cast<size_t>(MemoryCategory::Count)]{};
+    VkDeviceSize m_DeviceLocalBlockBytes{ 0 }; //blocks on device local heaps, lets EnforceSoftBudget follow its own frees without asking the driver
+    VkDeviceSize m_SoftBudget{ 0 };
+    std::vector<EvictionCallback> m_vEvictionCallbacks;
+    mutable std::mutex m_Mutex;
+
+    uint64_t createBlock(uint32_t memoryType, VkDeviceSize size, bool isDedicated);
+    void destroyBlock(uint64_t blockId);
+    //the shared blocks Free keeps around empty
+    void releaseEmptyBlocks();
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)const; //UINT32_MAX when there is none
+    bool isDeviceLocalHeap(uint32_t memoryType)const;
+};
@@ -0,0 +1,51 @@
+#include "FrameAllocator.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+
+FrameAllocator::FrameAllocator(DeviceAllocator& allocator, VkPhysicalDevice physicalDevice, uint32_t frameCount, VkDeviceSize frameCapacity)
+    : m_Allocator{ allocator }, m_FrameCount{ frameCount }
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_Alignment     = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    m_FrameCapacity = alignUp(frameCapacity, m_Alignment);
+
+    //host coherent, so what Push writes is visible to the submit without a flush
+    m_Allocator.CreateBuffer(m_FrameCapacity * m_FrameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_Buffer, m_Allocation, MemoryCategory::Uniform);
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    m_Allocator.DestroyBuffer(m_Buffer, m_Allocation);
+}
+
+void FrameAllocator::BeginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_FrameCount)
+        throw std::runtime_error("frame index out off range for the frame allocator");
+
+    m_PeakBytes  = std::max(m_PeakBytes, GetUsedBytes());
+    m_FrameBegin = m_FrameCapacity * frameIndex;
+    m_Head       = m_FrameBegin;
+}
+
+uint32_t FrameAllocator::Push(const void* pData, VkDeviceSize size)
+{
+    const VkDeviceSize offset = alignUp(m_Head, m_Alignment);
+    if (offset + size > m_FrameBegin + m_FrameCapacity)
+        throw std::runtime_error("frame allocator is full, raise the frame capacity");
+
+    memcpy(static_cast<uint8_t*>(m_Allocation.pMapped) + offset, pData, static_cast<size_t>(size));
+    m_Head = offset + size;
+    return static_cast<uint32_t>(offset);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "DeviceAllocator.h"
+#include <cstdint>
+
+//Transient per draw data (transforms, ...) for the frames in flight, one persistently mapped uniform buffer
+//split in one slice per frame. Push bumps a pointer in the slice off the current frame and returns the dynamic offset
+//to bind it with (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC), nothing gets allocated or freed per draw.
+//BeginFrame rewinds a slice in O(1), only call it once the fence off the frame that last used it signaled
+class FrameAllocator
+{
+public:
+    FrameAllocator(DeviceAllocator& allocator, VkPhysicalDevice physicalDevice, uint32_t frameCount, VkDeviceSize frameCapacity = m_DefaultFrameCapacity);
+    ~FrameAllocator();
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    void BeginFrame(uint32_t frameIndex);
+    //copies the data into the current slice, throws when the slice is full
+    uint32_t Push(const void* pData, VkDeviceSize size);
+    template<typename T>
+    uint32_t Push(const T& data) { return Push(&data, sizeof(T)); };
+
+    //the descriptor points at offset 0 off this buffer, the dynamic offset picks frame and draw
+    VkBuffer GetBuffer()const { return m_Buffer; };
+    VkDeviceSize GetUsedBytes()const { return m_Head - m_FrameBegin; };
+    //most bytes any frame used so far, to size the capacity
+    VkDeviceSize GetPeakBytes()const { return m_PeakBytes; };
+
+private:
+    static constexpr VkDeviceSize m_DefaultFrameCapacity{ 1ull << 20 };
+
+    DeviceAllocator& m_Allocator;
+    VkBuffer m_Buffer{ VK_NULL_HANDLE };
+    DeviceAllocation m_Allocation;
+    VkDeviceSize m_Alignment{ 1 };    //minUniformBufferOffsetAlignment
+    VkDeviceSize m_FrameCapacity;     //rounded up to the alignment so every slice starts aligned
+    uint32_t m_FrameCount;
+    VkDeviceSize m_FrameBegin{ 0 };
+    VkDeviceSize m_Head{ 0 };
+    VkDeviceSize m_PeakBytes{ 0 };
+};
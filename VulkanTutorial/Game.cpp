@@ -2,7 +2,12 @@
 #include <set>
 #include<algorithm>     // for clamp
 #include <limits>       //for numeric_limits
+#include <cstring>
 #include "Time.h"
+#include "TextureCache.h"
+#include "MipBuilder.h"
+#include "TextureLoader.h"
+#include "LoadLog.h"
 
 //#include <cstdint>      // for uint32_t
 #define STB_IMAGE_IMPLEMENTATION 
@@ -96,42 +101,78 @@ void Game::initVulkan()
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    m_pDeviceAllocator = std::make_unique<DeviceAllocator>(m_PhysicalDevice, m_LogicalDevice, m_HasMemoryBudget);
+    m_pDeviceAllocator->SetSoftBudget(m_SoftMemoryBudget);
+    //nothing in the scene can be dropped yet, so going over only gets reported (once per crossing)
+    m_pDeviceAllocator->AddEvictionCallback([this](VkDeviceSize bytesOverBudget)
+        {
+            if (!m_IsOverMemoryBudget)
+                std::cout << "over the soft memory budget by " << bytesOverBudget / (1024.f * 1024.f) << " MB\n";
+        });
+    m_pStagingRing = std::make_unique<StagingRing>(*m_pDeviceAllocator, m_LogicalDevice);
+    m_pMeshArena = std::make_unique<MeshArena>(*m_pDeviceAllocator);
     createSwapChain();
     createImageViews();
     createRenderPass();
     createDescriptorSetLayout();
-    m_p3DObject = std::make_unique< SceneObject>("models/vehicle.obj", "", true);
-    m_p3DObject2 = std::make_unique< SceneObject>("models/room.obj", "textures/viking_room.png", true);
-    m_p3DPipeline = std::make_unique<Pipeline>("shader/vert.spv", "shader/frag.spv", true);
-    m_p3DPipeline->Init(m_LogicalDevice, m_SwapChainExtent, m_DescriptorSetLayout, m_RenderPass, m_MsaaSamples);
-
-    m_p2DObject = std::make_unique< SceneObject>(m_vsQuare2D, m_vSquraInd);
+    createTextureSampler();
+    m_pTextureManager = std::make_unique<TextureManager>(m_PhysicalDevice, m_LogicalDevice, *m_pDeviceAllocator, m_TextureSampler);
+    m_p3DObject = std::make_unique< SceneObject>(m_MeshRegistry, "models/vehicle.obj", "", true, ObjLoadMode::Parallel, true, 4, VertexFormat::Packed3D);
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.f, -1.f, 0.f));
+    transform = glm::scale(transform, glm::vec3(0.025f));
+    m_p3DObject->SetTransform(glm::rotate(transform, glm::radians(90.f), glm::vec3(1.f, 0, 0)));
+    m_p3DObject2 = std::make_unique< SceneObject>(m_MeshRegistry, "models/room.obj", "textures/viking_room.png", true, ObjLoadMode::Streaming, true);
+    transform = glm::translate(glm::mat4(1.0f), glm::vec3(-1.f, 0.f, 0.f));
+    m_p3DObject2->SetTransform(glm::rotate(transform, /*Time::GetElapesedSec() **/ glm::radians(-m_RotationSpeed), glm::vec3(0.f, 0, 1.0f)));
+    m_p3DPipeline = std::make_unique<Pipeline>("shader/vert.spv", "shader/frag.spv", VertexFormat::Float3D);
+    m_p3DPipeline->Init(m_LogicalDevice, m_SwapChainExtent, m_DescriptorSetLayout, m_pTextureManager->GetDescriptorSetLayout(), m_RenderPass, m_MsaaSamples);
+    m_pPacked3DPipeline = std::make_unique<Pipeline>("shader/vertPacked.spv", "shader/frag.spv", VertexFormat::Packed3D);
+    m_pPacked3DPipeline->Init(m_LogicalDevice, m_SwapChainExtent, m_DescriptorSetLayout, m_pTextureManager->GetDescriptorSetLayout(), m_RenderPass, m_MsaaSamples);
+
+    m_p2DObject = std::make_unique< SceneObject>(m_vsQuare2D, m_vSquraInd, VertexFormat::Packed2D);
+    m_p2DObject->SetTransform(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.f, 0.f)));
     FillOvalResources({}, 0.25f, 16, m_vOval2D, m_vOvalInd);
-    m_p2DOvalObject = std::make_unique< SceneObject>(m_vOval2D, m_vOvalInd);
-    m_p2DPipeline = std::make_unique<Pipeline>("shader/vert2D.spv", "shader/frag.spv", false);
-    m_p2DPipeline->Init(m_LogicalDevice, m_SwapChainExtent, m_DescriptorSetLayout, m_RenderPass, m_MsaaSamples);
+    m_p2DOvalObject = std::make_unique< SceneObject>(m_vOval2D, m_vOvalInd, VertexFormat::Packed2D);
+    m_p2DOvalObject->SetTransform(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.f, 0.f)));
+    m_p2DPipeline = std::make_unique<Pipeline>("shader/vert2D.spv", "shader/frag.spv", VertexFormat::Packed2D);
+    m_p2DPipeline->Init(m_LogicalDevice, m_SwapChainExtent, m_DescriptorSetLayout, m_pTextureManager->GetDescriptorSetLayout(), m_RenderPass, m_MsaaSamples);
 
     m_pCamera = std::make_unique< Camera>(glm::vec3{ 2.0f, 2.0f, 2.0f }, glm::radians(45.f), m_SwapChainExtent.width / (float)m_SwapChainExtent.height);
     //m_pCamera->Init(glm::vec3{ 2.0f, 2.0f, 2.0f }, glm::radians(45.f), m_SwapChainExtent.width / (float)m_SwapChainExtent.height);
     createCommandPool();
     createColorResources();
     createDepthResources();
+    reportTransientAttachments();
     createFramebuffer();
-    createTextureImage();
-    createTextureImageView();
-    createTextureSampler();
+    //textures decode on the loader pool first, the models queue up behind them
+    LoadLog::SetVerbose(m_IsVerboseLoadLog);
+    m_pLoaderPool = std::make_unique<LoaderPool>();
+    createDefaultTexture();
+    std::vector<SceneObject*> vTexturedObjects{ m_p3DObject.get(), m_p3DObject2.get() };
+    std::vector<std::string> vTexturePaths;
+    for (SceneObject* object : vTexturedObjects)
+        vTexturePaths.push_back(object->GetTexturePath());
+    std::vector<uint32_t> vTextureIndices = loadTextures(vTexturePaths);
+    for (size_t i{}; i < vTexturedObjects.size(); ++i)
+        vTexturedObjects[i]->SetTextureIndex(vTextureIndices[i]);
     createCommandBuffers(m_vCommandBuffers);
     createCommandBuffers(m_vCommandBuffers2D);
-    m_p3DObject->Init(m_PhysicalDevice, m_LogicalDevice, m_CommandPool, MAX_FRAMES_IN_FLIGHT, m_GraphicsQueue);
-    m_p3DObject2->Init(m_PhysicalDevice, m_LogicalDevice, m_CommandPool, MAX_FRAMES_IN_FLIGHT, m_GraphicsQueue);
+    //models load in the background, the first frames render without them (see updateResidency)
+    m_p3DObject->InitAsync(*m_pLoaderPool);
+    m_p3DObject2->InitAsync(*m_pLoaderPool);
 
-    m_p2DObject->Init(m_PhysicalDevice, m_LogicalDevice, m_CommandPool, MAX_FRAMES_IN_FLIGHT, m_GraphicsQueue);
-    m_p2DOvalObject->Init(m_PhysicalDevice, m_LogicalDevice, m_CommandPool, MAX_FRAMES_IN_FLIGHT, m_GraphicsQueue);
+    m_p2DObject->InitAsync(*m_pLoaderPool);
+    m_p2DOvalObject->InitAsync(*m_pLoaderPool);
     
     createUniformBuffers();
     createDescriptorPool();
     createDescriptorSets();
     createSyncObjects();
+    //depth transition, texture copy and mips all go out together. The first frame samples the texture,
+    //with a transfer queue its mips only get submitted once the copy is done, so wait for that one batch here
+    std::shared_ptr<UploadBatch> pStartupBatch = getUploadBatch();
+    flushUploads();
+    pStartupBatch->Wait();
 }
 
 void Game::mainLoop()
@@ -146,27 +187,26 @@ void Game::mainLoop()
 
 void Game::cleanup()
 {
-    vkDestroyImageView(m_LogicalDevice, m_ColorImageView, nullptr);
-    vkDestroyImage(m_LogicalDevice, m_ColorImage, nullptr);
-    vkFreeMemory(m_LogicalDevice, m_ColorImageMemory, nullptr);
     cleanupSwapchain();
+    m_pTextureManager.reset();
     vkDestroySampler(m_LogicalDevice, m_TextureSampler, nullptr);
-    vkDestroyImageView(m_LogicalDevice, m_TextureImageView, nullptr);
-    vkDestroyImage(m_LogicalDevice, m_TextureImage, nullptr);
-    vkFreeMemory(m_LogicalDevice, m_TextureImageMemory, nullptr);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroyBuffer(m_LogicalDevice, m_vUniformBuffers[i], nullptr);
-        vkFreeMemory(m_LogicalDevice, m_vUniformBuffersMemory[i], nullptr);
+        m_pDeviceAllocator->DestroyBuffer(m_vUniformBuffers[i], m_vUniformBuffersAllocation[i]);
     }
+    m_pFrameAllocator.reset();
     vkDestroyDescriptorPool(m_LogicalDevice, m_DescriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(m_LogicalDevice, m_DescriptorSetLayout, nullptr);
     
-    m_p3DObject->Destroy(m_LogicalDevice);
-    m_p3DObject2->Destroy(m_LogicalDevice);
-    m_p2DObject->Destroy(m_LogicalDevice);
-    m_p2DOvalObject->Destroy(m_LogicalDevice);
+    m_pLoaderPool.reset(); //drops loads that did not start yet, so closing early does not wait on them
+    m_p3DObject->Destroy();
+    m_p3DObject2->Destroy();
+    m_p2DObject->Destroy();
+    m_p2DOvalObject->Destroy();
+    m_pUploadBatch.reset();
+    m_vSubmittedUploadBatches.clear(); //waits for whatever is still running
     m_p3DPipeline->Destroy(m_LogicalDevice);
+    m_pPacked3DPipeline->Destroy(m_LogicalDevice);
     m_p2DPipeline->Destroy(m_LogicalDevice);
 
     for (size_t i{}; i < MAX_FRAMES_IN_FLIGHT; ++i)
@@ -178,6 +218,11 @@ void Game::cleanup()
    
     vkDestroyRenderPass(m_LogicalDevice, m_RenderPass, nullptr);
     vkDestroyCommandPool(m_LogicalDevice, m_CommandPool, nullptr);
+    if (m_TransferCommandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(m_LogicalDevice, m_TransferCommandPool, nullptr);
+    m_pMeshArena.reset();
+    m_pStagingRing.reset();
+    m_pDeviceAllocator.reset(); //gives the memory blocks back
     vkDestroyDevice(m_LogicalDevice, nullptr);
     if (enableValidationLayers)
         DestroyDebugUtilMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
@@ -205,7 +250,7 @@ void Game::createInstance()
     appInfo.applicationVersion  = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName         = "No engine";
     appInfo.engineVersion       = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion          = VK_API_VERSION_1_0;
+    appInfo.apiVersion          = VK_API_VERSION_1_1; //vkGetPhysicalDeviceMemoryProperties2 for the memory budget
 
     //NESSECARY info -> nessecary for selecting the global extensions and validationLayers
     VkInstanceCreateInfo createInfo{};
@@ -377,7 +422,24 @@ bool Game::isDeviceSuitable(VkPhysicalDevice device) const
     //VkPhysicalDeviceFeatures deviceFeats;                            //-> for optional render features like for VR
     //vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &deviceFeats);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate /*&& bool(deviceFeats.samplerAnisotropy)*/;
+    //the texture array needs unsized, partially bound and update after bind sampler arrays,
+    //and the fragment shader indexes it with obj.textureIndex, which is only known at draw time
+    bool descriptorIndexingAdequate = false;
+    if (extensionsSupported)
+    {
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+        descriptorIndexingAdequate = features.features.shaderSampledImageArrayDynamicIndexing
+            && indexingFeatures.runtimeDescriptorArray
+            && indexingFeatures.descriptorBindingPartiallyBound
+            && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+    }
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && descriptorIndexingAdequate /*&& bool(deviceFeats.samplerAnisotropy)*/;
 }
 
 QueueFamilyIndices Game::findQueueFamilies(VkPhysicalDevice device) const
@@ -409,6 +471,17 @@ QueueFamilyIndices Game::findQueueFamilies(VkPhysicalDevice device) const
         i++;
     }
 
+    //transfer without graphics and compute is the copy engine on most gpus, copies there run next to the rendering
+    for (uint32_t family{}; family < queueFamilyCount; ++family)
+    {
+        const VkQueueFlags flags = vQueueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        {
+            indices.transferFamily = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -417,6 +490,8 @@ void Game::createLogicalDevice()
     QueueFamilyIndices indices = findQueueFamilies(m_PhysicalDevice);
     std::vector<VkDeviceQueueCreateInfo> vQueueCreateInfos;
     std::set<uint32_t>sUniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (indices.transferFamily.has_value())
+        sUniqueQueueFamilies.insert(indices.transferFamily.value());
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : sUniqueQueueFamilies)
     {
@@ -431,6 +506,7 @@ void Game::createLogicalDevice()
     VkPhysicalDeviceFeatures deviceFeatures{}; //default for now, is for when using more cool vulkan stuff
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.sampleRateShading = VK_TRUE;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE; //textures[obj.textureIndex], isDeviceSuitable checked it
 
     VkDeviceCreateInfo deviceInfo{};
     deviceInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -438,8 +514,31 @@ void Game::createLogicalDevice()
     deviceInfo.queueCreateInfoCount    = static_cast<uint32_t>(vQueueCreateInfos.size());
     deviceInfo.pEnabledFeatures        = &deviceFeatures;
 
-    deviceInfo.enabledExtensionCount   = static_cast<uint32_t>(m_vDeviceExtensions.size()); //extension for swapchain
-    deviceInfo.ppEnabledExtensionNames = m_vDeviceExtensions.data();
+    //isDeviceSuitable already checked these
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType                                       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    indexingFeatures.runtimeDescriptorArray                      = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound             = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    deviceInfo.pNext                   = &indexingFeatures;
+
+    //the memory budget is optional, without it the allocator only knows its own blocks
+    std::vector<const char*> vEnabledExtensions = m_vDeviceExtensions;
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> vAvailableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, vAvailableExtensions.data());
+    for (const auto& extension : vAvailableExtensions)
+    {
+        if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+        {
+            vEnabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            m_HasMemoryBudget = true;
+        }
+    }
+
+    deviceInfo.enabledExtensionCount   = static_cast<uint32_t>(vEnabledExtensions.size()); //extension for swapchain
+    deviceInfo.ppEnabledExtensionNames = vEnabledExtensions.data();
 
     //Validation layers
     if (enableValidationLayers) {
@@ -454,6 +553,11 @@ void Game::createLogicalDevice()
 
     vkGetDeviceQueue(m_LogicalDevice, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
     vkGetDeviceQueue(m_LogicalDevice, indices.presentFamily.value(), 0, &m_PresentQueue);
+    if (indices.transferFamily.has_value())
+    {
+        vkGetDeviceQueue(m_LogicalDevice, indices.transferFamily.value(), 0, &m_TransferQueue);
+        std::cout << "uploads use the transfer queue family " << indices.transferFamily.value() << "\n";
+    }
 }
 
 bool Game::checkDeviceExtensionSupport(VkPhysicalDevice phDevice)const
@@ -627,14 +731,17 @@ void Game::recreateSwapchain()
     createImageViews();
     createColorResources();
     createDepthResources();
+    reportTransientAttachments();
     createFramebuffer();
+    flushUploads();
 }
 
 void Game::cleanupSwapchain()
 {
+    vkDestroyImageView(m_LogicalDevice, m_ColorImageView, nullptr);
+    m_pDeviceAllocator->DestroyImage(m_ColorImage, m_ColorImageAllocation);
     vkDestroyImageView(m_LogicalDevice, m_DepthImageView, nullptr);
-    vkDestroyImage(m_LogicalDevice, m_DepthImage, nullptr);
-    vkFreeMemory(m_LogicalDevice, m_DepthImageMemory, nullptr);
+    m_pDeviceAllocator->DestroyImage(m_DepthImage, m_DepthImageAllocation);
 
     for (auto& buffer : m_vSwapchainFramebuffers)
     {
@@ -669,7 +776,7 @@ void Game::createRenderPass()
     collorAttachment.samples = m_MsaaSamples;
     //color and depth
     collorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; //start with black background
-    collorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    collorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; //only the resolve is kept, so the samples never have to leave tile memory
     //stencil data
     collorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     collorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -810,6 +917,25 @@ void Game::createCommandPool()
     {
         throw std::runtime_error("Creation off commandPool failed");
     }
+
+    m_UploadQueues.graphicsQueue       = m_GraphicsQueue;
+    m_UploadQueues.graphicsCommandPool = m_CommandPool;
+    m_UploadQueues.graphicsFamily      = queueFamilyIndices.graphicsFamily.value();
+    m_UploadQueues.transferQueue       = m_GraphicsQueue;
+    m_UploadQueues.transferCommandPool = m_CommandPool;
+    m_UploadQueues.transferFamily      = queueFamilyIndices.graphicsFamily.value();
+    if (queueFamilyIndices.transferFamily.has_value())
+    {
+        //upload command buffers are one time submits, no reset flag needed
+        CommandPoolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        CommandPoolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value();
+        if (vkCreateCommandPool(m_LogicalDevice, &CommandPoolInfo, nullptr, &m_TransferCommandPool) != VK_SUCCESS)
+            throw std::runtime_error("Creation off transfer commandPool failed");
+
+        m_UploadQueues.transferQueue       = m_TransferQueue;
+        m_UploadQueues.transferCommandPool = m_TransferCommandPool;
+        m_UploadQueues.transferFamily      = queueFamilyIndices.transferFamily.value();
+    }
 }
 
 void Game::createCommandBuffers(std::vector<VkCommandBuffer>& commandBuffers)
@@ -861,35 +987,41 @@ void Game::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageInde
     //3D PIPELINE
 
     //Binding off vertexbuffer
-    pipeline->Record(commandBuffer, m_vDescriptorSets[m_CurrentFrame]);
+    pipeline->Record(commandBuffer);
+    //all pipeline layouts match, the texture array stays bound for the whole pass
+    m_pTextureManager->Bind(commandBuffer, pipeline->GetPipelineLayout());
+    //vertex and index bindings survive pipeline binds, meshes sharing an arena buffer bind it once for the whole pass
+    MeshBindState bindState{};
    
     //Room
-    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(-1.f, 0.f, 0.f));
-    //transform = glm::translate(transform, m_pCamera->GetPosition());
-    transform = glm::rotate(transform, /*Time::GetElapesedSec() **/ glm::radians(-m_RotationSpeed), glm::vec3(0.f, 0, 1.0f));
-    vkCmdPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &transform);
-    object->Record(commandBuffer);
-
-    //vehicle 
-    transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.f, -1.f, 0.f));
-    transform = glm::scale(transform, glm::vec3(0.025f));
-    transform = glm::rotate(transform, glm::radians(90.f), glm::vec3(1.f, 0, 0));
-    vkCmdPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &transform);
-    m_p3DObject->Record(commandBuffer);
+    if (object->IsResident())
+    {
+        pipeline->BindDrawData(commandBuffer, m_vDescriptorSets[m_CurrentFrame], m_pFrameAllocator->Push(ObjectUniformData{ object->GetTransform(), object->GetTextureIndex() }));
+        object->Record(commandBuffer, getSceneModelMatrix(), *m_pCamera, static_cast<float>(m_SwapChainExtent.height), nullptr, &bindState);
+    }
+
+    //vehicle (packed vertices, the object transform also undoes the position quantization)
+    m_pPacked3DPipeline->Record(commandBuffer);
+    if (m_p3DObject->IsResident())
+    {
+        glm::mat4 vertexTransform = m_p3DObject->GetTransform() * m_p3DObject->GetVertexTransform();
+        m_pPacked3DPipeline->BindDrawData(commandBuffer, m_vDescriptorSets[m_CurrentFrame], m_pFrameAllocator->Push(ObjectUniformData{ vertexTransform, m_p3DObject->GetTextureIndex() }));
+        m_p3DObject->Record(commandBuffer, getSceneModelMatrix(), *m_pCamera, static_cast<float>(m_SwapChainExtent.height), nullptr, &bindState);
+    }
 
 
     //----------------------------------------
    //2D PIPELINE
 
-    m_p2DPipeline->Record(commandBuffer, m_vDescriptorSets[m_CurrentFrame]);
+    m_p2DPipeline->Record(commandBuffer);
 
-    transform = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.f, 0.f));
-    vkCmdPushConstants(commandBuffer, m_p2DPipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &transform);
-    m_p2DObject->Record(commandBuffer);
-    
-    transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.f, 0.f));
-    vkCmdPushConstants(commandBuffer, m_p2DPipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &transform);
-    m_p2DOvalObject->Record(commandBuffer);
+    for (SceneObject* object2D : { m_p2DObject.get(), m_p2DOvalObject.get() })
+    {
+        if (!object2D->IsResident())
+            continue;
+        m_p2DPipeline->BindDrawData(commandBuffer, m_vDescriptorSets[m_CurrentFrame], m_pFrameAllocator->Push(ObjectUniformData{ object2D->GetTransform(), object2D->GetTextureIndex() }));
+        object2D->Record(commandBuffer, nullptr, &bindState);
+    }
 
 
 
@@ -903,11 +1035,66 @@ void Game::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageInde
    
 }
 
+void Game::updateResidency()
+{
+    bool allResident{ true };
+    for (SceneObject* object : { m_p3DObject.get(), m_p3DObject2.get(), m_p2DObject.get(), m_p2DOvalObject.get() })
+        allResident &= object->UpdateResidency(*m_pDeviceAllocator, *m_pMeshArena, getUploadBatch());
+    //one submit for every mesh that finished loading since last frame, before the frame that draws them
+    flushUploads();
+
+    //print how the device memory ended up once everything is loaded
+    if (allResident && !m_HasPrintedMemoryStats)
+    {
+        m_HasPrintedMemoryStats = true;
+        const DeviceAllocatorStats stats = m_pDeviceAllocator->GetStats();
+        std::cout << "device memory: " << stats.blockCount << " blocks (" << stats.dedicatedBlockCount << " dedicated), "
+            << stats.allocationCount << " allocations, "
+            << stats.usedBytes / (1024.f * 1024.f) << " MB used, "
+            << stats.freeBytes / (1024.f * 1024.f) << " MB free, "
+            << "fragmentation " << stats.fragmentation * 100.f << "%, "
+            << "mesh arena " << m_pMeshArena->GetUsedBytes() / (1024.f * 1024.f) << " off " << m_pMeshArena->GetCapacityBytes() / (1024.f * 1024.f)
+            << " MB in " << m_pMeshArena->GetBufferCount() << " buffers, "
+            << "frame data peak " << m_pFrameAllocator->GetPeakBytes() / 1024.f << " KB, "
+            << "staging ring stalls " << m_pStagingRing->GetStallCount() << "\n";
+    }
+
+    m_IsOverMemoryBudget = m_pDeviceAllocator->EnforceSoftBudget();
+    logMemoryBudget();
+}
+
+void Game::logMemoryBudget()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (m_LastMemoryLog != std::chrono::steady_clock::time_point{}
+        && std::chrono::duration<float>(now - m_LastMemoryLog).count() < m_MemoryLogInterval)
+        return;
+    m_LastMemoryLog = now;
+
+    const MemoryBudget budget = m_pDeviceAllocator->GetBudget();
+    std::cout << "memory:";
+    for (size_t category{}; category < static_cast<size_t>(MemoryCategory::Count); ++category)
+        std::cout << " " << DeviceAllocator::GetCategoryName(static_cast<MemoryCategory>(category)) << " " << budget.categoryBytes[category] / (1024.f * 1024.f) << " MB,";
+    for (size_t heap{}; heap < budget.vHeaps.size(); ++heap)
+    {
+        const MemoryHeapUsage& usage = budget.vHeaps[heap];
+        if (usage.blockBytes == 0 && usage.driverUsage == 0)
+            continue;
+        std::cout << " heap " << heap << (usage.isDeviceLocal ? " (device local) " : " ") << usage.blockBytes / (1024.f * 1024.f) << " MB";
+        if (budget.hasDriverBudget)
+            std::cout << " (process " << usage.driverUsage / (1024.f * 1024.f) << " off " << usage.driverBudget / (1024.f * 1024.f) << " MB budget)";
+        std::cout << ",";
+    }
+    std::cout << " soft budget " << budget.deviceLocalUsage / (1024.f * 1024.f) << " off " << m_SoftMemoryBudget / (1024.f * 1024.f) << " MB\n";
+}
+
 void Game::drawFrame()
 {
 
     //1. wait for previous frame
     vkWaitForFences(m_LogicalDevice, 1, &m_vInFlightFences[m_CurrentFrame], VK_TRUE, UINT32_MAX);
+    //the gpu is done with the per draw data off this frame
+    m_pFrameAllocator->BeginFrame(m_CurrentFrame);
 
     //2.Aquire an image from the swap chain
     uint32_t imageIndex;
@@ -922,7 +1109,8 @@ void Game::drawFrame()
 
     vkResetFences(m_LogicalDevice, 1, &m_vInFlightFences[m_CurrentFrame]);
 
-    //3.Recording the command buffer
+    //3.Recording the command buffer, objects that finished loading get uploaded first
+    updateResidency();
     vkResetCommandBuffer(m_vCommandBuffers[m_CurrentFrame], 0);
     recordCommandBuffer(m_vCommandBuffers[m_CurrentFrame], imageIndex, m_p3DPipeline.get(), m_p3DObject2.get());
     
@@ -1005,28 +1193,11 @@ void Game::createSyncObjects()
 
 
 
-uint32_t Game::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-    VkPhysicalDeviceMemoryProperties memProps{};
-    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProps);
-
-    for (uint32_t i{}; i < memProps.memoryTypeCount; ++i)
-    {
-        if (typeFilter & (1 << i) && (memProps.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type");
-}
-
-
 void Game::createUniformBuffers()
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
     m_vUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    m_vUniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    m_vUniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
     m_vUniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
     // no need to assign a staging buffer since we plan to update this every frame, which would cause it to be slower
@@ -1035,21 +1206,25 @@ void Game::createUniformBuffers()
         createBuffer(bufferSize,
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            m_vUniformBuffers[i], m_vUniformBuffersMemory[i]);
-        vkMapMemory(m_LogicalDevice, m_vUniformBuffersMemory[i], 0, bufferSize, 0, &m_vUniformBuffersMapped[i]);
+            m_vUniformBuffers[i], m_vUniformBuffersAllocation[i], MemoryCategory::Uniform);
+        m_vUniformBuffersMapped[i] = m_vUniformBuffersAllocation[i].pMapped;
         //Will be mapped until end off aplication -> called: Persistent Mapping
         //Maps only at creation instead off every frame so you can use the given pointer to update it in draw
     }
 
+    //the per draw transforms, one slice per frame in flight behind a single dynamic descriptor
+    m_pFrameAllocator = std::make_unique<FrameAllocator>(*m_pDeviceAllocator, m_PhysicalDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+
 }
 
 void Game::createDescriptorPool()
 {
+    //the textures live in the TextureManager set
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
- 
-    poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    poolSizes[1].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
     VkDescriptorPoolCreateInfo poolInfo{};
@@ -1089,10 +1264,11 @@ void Game::createDescriptorSets()
         bufferInfo.offset    = 0;
         bufferInfo.range     = sizeof(UniformBufferObject);
         
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView   = m_TextureImageView;
-        imageInfo.sampler     = m_TextureSampler;
+        //range is one draw, the dynamic offset moves it over the whole buffer
+        VkDescriptorBufferInfo drawDataInfo{};
+        drawDataInfo.buffer = m_pFrameAllocator->GetBuffer();
+        drawDataInfo.offset = 0;
+        drawDataInfo.range  = sizeof(ObjectUniformData);
 
         //here they get combined
         std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
@@ -1106,11 +1282,11 @@ void Game::createDescriptorSets()
         
         descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[1].dstSet          = m_vDescriptorSets[i];
-        descriptorWrites[1].dstBinding      = 1;
+        descriptorWrites[1].dstBinding      = 2;
         descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo      = &imageInfo;
+        descriptorWrites[1].pBufferInfo     = &drawDataInfo;
         
 
         vkUpdateDescriptorSets(m_LogicalDevice, 
@@ -1124,48 +1300,21 @@ void Game::createDescriptorSets()
 void Game::createBuffer(VkDeviceSize bufferSize, 
                     VkBufferUsageFlags flags, 
                     VkMemoryPropertyFlags memryProps, 
-                    VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory)
+                    VkBuffer& vertexBuffer, DeviceAllocation& vertexBufferAllocation,
+                    MemoryCategory category)
 {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = bufferSize;
-    bufferInfo.usage = flags;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; //only used by graphicsqueue so exlusive is enough
-
-    if (vkCreateBuffer(m_LogicalDevice, &bufferInfo, nullptr, &vertexBuffer) != VK_SUCCESS)
-        throw std::runtime_error("creation off vertex buffer failed");
-
-    VkMemoryRequirements memRequirements{};
-    vkGetBufferMemoryRequirements(m_LogicalDevice, vertexBuffer, &memRequirements);
-
-    //Memory allocation
-    VkMemoryAllocateInfo allocateInfo{};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.allocationSize = memRequirements.size;
-    allocateInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, memryProps);
-
-    if (vkAllocateMemory(m_LogicalDevice, &allocateInfo, nullptr, &vertexBufferMemory) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate memory for vertex buffer");
-
-    //Filling the Vertex buffer
-    vkBindBufferMemory(m_LogicalDevice, vertexBuffer, vertexBufferMemory, 0);
+    //only used by graphicsqueue so exlusive is enough, the memory is a piece off a shared block
+    m_pDeviceAllocator->CreateBuffer(bufferSize, flags, memryProps, vertexBuffer, vertexBufferAllocation, category);
 }
 
 void Game::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
-    VkCommandBuffer commandBuffer = beginSingleCommands();
-
-    //Copy
+    //Copy, goes out with the next flushUploads
     VkBufferCopy copyRegion{};
     copyRegion.srcOffset = 0; // Optional
     copyRegion.dstOffset = 0; // Optional
     copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    //Stop recording
-    endSingleCommands(commandBuffer);
-
-
+    vkCmdCopyBuffer(getUploadBatch()->GetGraphicsCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
 }
 
 void Game::createDescriptorSetLayout()
@@ -1177,14 +1326,15 @@ void Game::createDescriptorSetLayout()
     uboLayoutDescription.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;
     uboLayoutDescription.pImmutableSamplers = nullptr;//only relevant for image sampling
    
-    VkDescriptorSetLayoutBinding samplerLayoutDescription{};
-    samplerLayoutDescription.binding            = 1;
-    samplerLayoutDescription.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutDescription.descriptorCount    = 1;
-    samplerLayoutDescription.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
-    samplerLayoutDescription.pImmutableSamplers = nullptr;//only relevant for image sampling
-
-    std::array<VkDescriptorSetLayoutBinding, 2>  bindings = { uboLayoutDescription, samplerLayoutDescription };
+    //binding 1 (the one texture) moved to the TextureManager array in set 1
+    VkDescriptorSetLayoutBinding drawDataLayoutDescription{};
+    drawDataLayoutDescription.binding            = 2;
+    drawDataLayoutDescription.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    drawDataLayoutDescription.descriptorCount    = 1;
+    drawDataLayoutDescription.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; //the fragment shader reads textureIndex
+    drawDataLayoutDescription.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 2>  bindings = { uboLayoutDescription, drawDataLayoutDescription };
     VkDescriptorSetLayoutCreateInfo uboInfo{};
     uboInfo.sType            = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     uboInfo.bindingCount     = static_cast<uint32_t>(bindings.size());
@@ -1196,10 +1346,16 @@ void Game::createDescriptorSetLayout()
     }
 }
 
+//model matrix off the uniform buffer, the per draw object transforms go on top off it
+glm::mat4 Game::getSceneModelMatrix()const
+{
+    return glm::rotate(glm::mat4(1.0f), /*Time::GetElapesedSec() **/ glm::radians(m_RotationSpeed), glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
 void Game::updateUniformBuffer(uint32_t currentImage)
 {
     UniformBufferObject ubo{};
-    ubo.model = glm::rotate(glm::mat4(1.0f), /*Time::GetElapesedSec() **/ glm::radians(m_RotationSpeed), glm::vec3(0.0f, 0.0f, 1.0f));
+    ubo.model = getSceneModelMatrix();
     //ubo.view = m_pCamera->CalculateViewMatrix();
     ubo.view  = glm::lookAt(m_pCamera->GetPosition(), m_pCamera->GetWorldCenterPosition(), glm::vec3(0.0f, 0.0f, 1.0f));// up vector
     //m_pCamera->CalculateViewMatrix();
@@ -1214,55 +1370,152 @@ void Game::updateUniformBuffer(uint32_t currentImage)
 
 }
 
-void Game::createTextureImage()
+std::vector<uint32_t> Game::loadTextures(const std::vector<std::string>& vTexturePaths)
+{
+    //every path once, the ones the TextureManager already has keep their slot
+    std::vector<uint32_t> vIndices(vTexturePaths.size());
+    std::vector<std::string> vNewPaths;
+    for (size_t i{}; i < vTexturePaths.size(); ++i)
+    {
+        if (!m_pTextureManager->Find(vTexturePaths[i], vIndices[i])
+            && std::find(vNewPaths.begin(), vNewPaths.end(), vTexturePaths[i]) == vNewPaths.end())
+            vNewPaths.push_back(vTexturePaths[i]);
+    }
+    if (vNewPaths.empty())
+        return vIndices;
+
+    //BC blocks when the device can sample them, the gpu blits are only an option for rgba8
+    TextureLoadSettings settings{};
+    settings.isCompressing   = m_IsTextureCompressed
+        && canSampleTexture(VK_FORMAT_BC1_RGB_SRGB_BLOCK) && canSampleTexture(VK_FORMAT_BC3_SRGB_BLOCK);
+    settings.isCompressingNormals = settings.isCompressing && canSampleTexture(VK_FORMAT_BC5_UNORM_BLOCK);
+    settings.isBlitMipmapped = !settings.isCompressing && !m_IsCpuMipmaps && canBlitMipmaps(VK_FORMAT_R8G8B8A8_SRGB);
+
+    //the workers decode/map every texture at once. Meanwhile this thread takes them in order, allocates their staging,
+    //creates the image and records the copy, and the levels get copied into the mapped staging by the pool as well
+    auto startTime = std::chrono::high_resolution_clock::now();
+    TextureLoader textureLoader{ *m_pLoaderPool, settings };
+    std::vector<LoadedTexture> vTextures;
+    std::vector<std::future<void>> vLoads = textureLoader.Load(vNewPaths, vTextures);
+    std::vector<std::future<void>> vFills;
+    UploadBatch& uploadBatch = *getUploadBatch();
+    //the jobs hold pointers into vTextures and the mapped staging, so none off them may outlive a failed load
+    try {
+        for (size_t i{}; i < vTextures.size(); ++i)
+        {
+            vLoads[i].get();
+            const LoadedTexture& texture = vTextures[i];
+            StagingRegion staging = uploadBatch.Allocate(texture.GetPixelBytes());
+            vFills.push_back(textureLoader.Fill(texture, staging));
+
+            VkImage image;
+            DeviceAllocation allocation;
+            uint32_t mipCount = texture.GetMipCount();
+            if (texture.isBlitMipmapped)
+                uploadBlitMipmappedTexture(staging, texture.vMips[0].width, texture.vMips[0].height, texture.format, image, allocation, mipCount);
+            else
+                uploadTexture(texture.vMips.data(), mipCount, staging, texture.format, image, allocation);
+            m_pTextureManager->Add(texture.path, image, allocation, texture.format, mipCount);
+
+            if (LoadLog::IsVerbose())
+                std::cout << texture.path << (texture.IsCached() ? " from texture cache: " : " decoded and cooked: ")
+                    << texture.milliseconds << "ms, " << mipCount << " mips\n";
+            //with the verbose log a bad looking texture can be traced to the compressor
+            if (LoadLog::IsVerbose() && texture.compressionStats.compressedBytes != 0)
+                std::cout << texture.path << " compressed: " << texture.compressionStats.sourceBytes / 1024 << "KB -> " << texture.compressionStats.compressedBytes / 1024 << "KB, "
+                    << texture.compressionStats.psnr << "dB psnr, " << texture.compressionStats.megapixelsPerSecond << " MP/s\n";
+            if (!texture.IsCached() && !texture.isBlitMipmapped && !texture.isCacheWritten)
+                std::cout << "failed to write texture cache for " << texture.path << "\n";
+        }
+    }
+    catch (...) {
+        for (auto& load : vLoads)
+            load.wait();
+        for (auto& fill : vFills)
+            fill.wait();
+        throw;
+    }
+    //the staging has to be written before the batch goes out
+    for (auto& fill : vFills)
+        fill.get();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    if (LoadLog::IsVerbose())
+        std::cout << vTextures.size() << " textures loaded in " << std::chrono::duration<float, std::milli>(endTime - startTime).count() << "ms\n";
+
+    for (size_t i{}; i < vTexturePaths.size(); ++i)
+        m_pTextureManager->Find(vTexturePaths[i], vIndices[i]);
+    return vIndices;
+}
+
+void Game::uploadTexture(const TextureCacheMip* pMips, uint32_t mipCount, const StagingRegion& staging, VkFormat format,
+    VkImage& image, DeviceAllocation& allocation)
 {
-    //load image
-    int texWidth{}, textHeight{}, textChannels{};
-    stbi_uc* pixels = stbi_load(m_TexturePath.c_str(), &texWidth, &textHeight, &textChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * textHeight * 4;
+    //create image to transfer to and bind, every level comes from the buffer so no TRANSFER_SRC for blits
+    createImage(pMips[0].width, pMips[0].height, mipCount, VK_SAMPLE_COUNT_1_BIT,
+        format, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        image, allocation, MemoryCategory::Texture);
 
-    m_MipLvl = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, textHeight)))) + 1;
+    //one copy with a region per mip, the layout goes to SHADER_READ_ONLY with the hand over to the graphics queue
+    UploadBatch& uploadBatch = *getUploadBatch();
+    transitionImageLayout(uploadBatch.GetTransferCommandBuffer(), image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount);
 
-    if (!pixels)
+    std::vector<VkBufferImageCopy> vRegions(mipCount);
+    for (uint32_t mip{}; mip < mipCount; ++mip)
     {
-        throw std::runtime_error{ "failed to load texture image" };
+        VkBufferImageCopy& region = vRegions[mip];
+        region = {};
+        region.bufferOffset                    = pMips[mip].offset;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = mip;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageExtent                     = { pMips[mip].width, pMips[mip].height, 1 };
     }
+    uploadBatch.CopyBufferToImage(staging, image, vRegions.data(), mipCount);
+    uploadBatch.HandImageToGraphics(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipCount,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
 
-    //create staging buffer to load in host memory
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingbufferMemory;
-    createBuffer(imageSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        stagingBuffer, stagingbufferMemory);
+void Game::createDefaultTexture()
+{
+    //slot 0, registered under the empty path so objects without a texture find it
+    const uint8_t white[4]{ 255, 255, 255, 255 };
+    const TextureCacheMip mip{ 0, sizeof(white), 1, 1 };
+    VkImage image;
+    DeviceAllocation allocation;
+    uploadTexture(&mip, 1, getUploadBatch()->Stage(white, sizeof(white)), VK_FORMAT_R8G8B8A8_UNORM, image, allocation);
+    m_pTextureManager->Add("", image, allocation, VK_FORMAT_R8G8B8A8_UNORM, 1);
+}
 
-    void* data;
-    vkMapMemory(m_LogicalDevice, stagingbufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(m_LogicalDevice, stagingbufferMemory);
-    
-    stbi_image_free(pixels);
+void Game::uploadBlitMipmappedTexture(const StagingRegion& staging, uint32_t width, uint32_t height, VkFormat format,
+    VkImage& image, DeviceAllocation& allocation, uint32_t& mipCount)
+{
+    mipCount = MipBuilder::CalculateMipCount(width, height);
 
     //create image to transfer to and bind
-    createImage(texWidth, textHeight, m_MipLvl, VK_SAMPLE_COUNT_1_BIT,
-        VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+    createImage(width, height, mipCount, VK_SAMPLE_COUNT_1_BIT,
+        format, VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        m_TextureImage, m_TextureImageMemory);
+        image, allocation, MemoryCategory::Texture);
 
-    transitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_MipLvl);
-    copyBufferToImage(stagingBuffer, m_TextureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(textHeight));
-    //transitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_MipLvl);
-    generateMipmaps(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, textHeight, m_MipLvl);
+    //transition, copy and mip blits all record into the open upload batch, the blits need the graphics queue
+    UploadBatch& uploadBatch = *getUploadBatch();
+    transitionImageLayout(uploadBatch.GetTransferCommandBuffer(), image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount);
 
-    vkDestroyBuffer(m_LogicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(m_LogicalDevice, stagingbufferMemory, nullptr);
+    uploadBatch.CopyBufferToImage(staging, image, width, height);
+    uploadBatch.HandImageToGraphics(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+    generateMipmaps(uploadBatch.GetGraphicsCommandBuffer(), image, format, static_cast<int32_t>(width), static_cast<int32_t>(height), mipCount);
 }
 
 void Game::createImage(uint32_t width, uint32_t height, uint32_t mipLvls, VkSampleCountFlagBits numSamples,
     VkFormat format, VkImageTiling tiling, 
     VkImageUsageFlags usage, VkMemoryPropertyFlags properties, 
-    VkImage& image, VkDeviceMemory& imageMemory)
+    VkImage& image, DeviceAllocation& imageAllocation, MemoryCategory category)
 {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType          = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1280,32 +1533,8 @@ void Game::createImage(uint32_t width, uint32_t height, uint32_t mipLvls, VkSamp
     imageInfo.samples        = numSamples;
     imageInfo.flags          = 0;
 
-    if (vkCreateImage(m_LogicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
-    {
-        throw std::runtime_error{ "failed to create image" };
-    }
-
     //transfer to fast allocation memory
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_LogicalDevice, image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(m_LogicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error{ "failed to allocate image memory" };
-    }
-
-    vkBindImageMemory(m_LogicalDevice, image, imageMemory, 0);
-
-}
-
-void Game::createTextureImageView()
-{
-    m_TextureImageView = createImageView(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLvl);
+    m_pDeviceAllocator->CreateImage(imageInfo, properties, image, imageAllocation, category);
 }
 
 void Game::createColorResources()
@@ -1314,7 +1543,7 @@ void Game::createColorResources()
     
     createImage(m_SwapChainExtent.width, m_SwapChainExtent.height, 1, m_MsaaSamples, colorFormat, 
         VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ColorImage, m_ColorImageMemory);
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, m_ColorImage, m_ColorImageAllocation, MemoryCategory::Attachment);
     m_ColorImageView = createImageView(m_ColorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
 
@@ -1344,8 +1573,8 @@ void Game::createTextureSampler()
     samplerInfo.compareOp     = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode    = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias    = 0.0f;
-    samplerInfo.minLod        = static_cast<float>(m_MipLvl/4.f);
-    samplerInfo.maxLod        = static_cast<float>(m_MipLvl);
+    samplerInfo.minLod        = 0.0f; //shared by every texture in the array, so no per texture mip range
+    samplerInfo.maxLod        = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(m_LogicalDevice, &samplerInfo, nullptr, &m_TextureSampler) != VK_SUCCESS)
     {
@@ -1358,21 +1587,38 @@ void Game::createDepthResources()
 {
     VkFormat depthFormat = findDepthFormat();
     createImage(m_SwapChainExtent.width, m_SwapChainExtent.height, 1, m_MsaaSamples, depthFormat,
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DepthImage, m_DepthImageMemory);
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, m_DepthImage, m_DepthImageAllocation, MemoryCategory::Attachment);
     m_DepthImageView = createImageView(m_DepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
   
     //optional since its mostly handeld by render pass
-    transitionImageLayout(m_DepthImage, depthFormat, 
+    transitionImageLayout(getUploadBatch()->GetGraphicsCommandBuffer(), m_DepthImage, depthFormat, 
                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 
 }
 
-void Game::transitionImageLayout(VkImage image, VkFormat format, 
+void Game::reportTransientAttachments()
+{
+    //depth is stored as DONT_CARE and the color samples get resolved into the swapchain, neither is read after the pass.
+    //Both are live in the same subpass so they can not alias each other, without lazily allocated memory they stay fully backed
+    VkDeviceSize totalBytes{ 0 }, savedBytes{ 0 };
+    bool isLazy{ true };
+    for (const DeviceAllocation* pAllocation : { &m_ColorImageAllocation, &m_DepthImageAllocation })
+    {
+        totalBytes += pAllocation->size;
+        savedBytes += pAllocation->size - m_pDeviceAllocator->GetCommittedBytes(*pAllocation);
+        isLazy &= m_pDeviceAllocator->IsLazilyAllocated(*pAllocation);
+    }
+
+    std::cout << "transient attachments " << m_SwapChainExtent.width << "x" << m_SwapChainExtent.height << ": "
+        << totalBytes / (1024.f * 1024.f) << " MB, " << savedBytes / (1024.f * 1024.f) << " MB saved"
+        << (isLazy ? " (lazily allocated)\n" : " (no lazily allocated memory on this device)\n");
+}
+
+void Game::transitionImageLayout(VkCommandBuffer commandbuffer, VkImage image, VkFormat format, 
                         VkImageLayout oldLayout, VkImageLayout newLayout,
                             uint32_t mipLvls)
 {
-    VkCommandBuffer commandbuffer = beginSingleCommands();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1440,19 +1686,29 @@ void Game::transitionImageLayout(VkImage image, VkFormat format,
         0, nullptr,
         1, &barrier
     );
-
-    endSingleCommands(commandbuffer);
-
 }
 
-void Game::generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+bool Game::canSampleTexture(VkFormat format)
 {
-    VkCommandBuffer commandBuffer = beginSingleCommands();
+    //the sampler filters linearly, so a format without it is as good as unsupported
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &formatProperties);
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+        | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (formatProperties.optimalTilingFeatures & features) == features;
+}
 
+bool Game::canBlitMipmaps(VkFormat format)
+{
     //check if physical device supports linear filtering
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &formatProperties);
-    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) 
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+}
+
+void Game::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+{
+    if (!canBlitMipmaps(format))
     {
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
@@ -1529,9 +1785,6 @@ void Game::generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int
                     0, nullptr,
                     0, nullptr,
                     1, &barrier);
-
-
-    endSingleCommands(commandBuffer);
 }
 
 VkImageView Game::createImageView(VkImage image, VkFormat format, 
@@ -1585,65 +1838,25 @@ bool Game::hasStencilComponent(VkFormat format)
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-VkCommandBuffer Game::beginSingleCommands()
+const std::shared_ptr<UploadBatch>& Game::getUploadBatch()
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool        = m_CommandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(m_LogicalDevice, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    return commandBuffer;
-}
-
-void Game::endSingleCommands(VkCommandBuffer commandBuffer)
-{
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffer;
-
-    vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_GraphicsQueue);
-
-    vkFreeCommandBuffers(m_LogicalDevice, m_CommandPool, 1, &commandBuffer);
-
+    if (!m_pUploadBatch)
+        m_pUploadBatch = std::make_shared<UploadBatch>(m_LogicalDevice, m_UploadQueues, *m_pStagingRing);
+    return m_pUploadBatch;
 }
 
-void Game::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void Game::flushUploads()
 {
-    VkCommandBuffer commandBuffer = beginSingleCommands();
-
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = { 0,0,0 };
-    region.imageExtent = { width, height, 1 };
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, 
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    endSingleCommands(commandBuffer);
+    if (m_pUploadBatch && !m_pUploadBatch->IsEmpty())
+    {
+        m_pUploadBatch->Submit();
+        m_vSubmittedUploadBatches.push_back(std::move(m_pUploadBatch));
+        m_pUploadBatch.reset();
+    }
 
+    //done batches give their command buffer back, meshes still holding one keep it alive until they saw it finish
+    m_vSubmittedUploadBatches.erase(std::remove_if(m_vSubmittedUploadBatches.begin(), m_vSubmittedUploadBatches.end(),
+        [](const std::shared_ptr<UploadBatch>& pBatch) { return pBatch->IsComplete(); }), m_vSubmittedUploadBatches.end());
 }
 
 VkSampleCountFlagBits Game::getMaxUsableSampleCount()
@@ -12,6 +12,7 @@
 
 #include <vector>
 #include <string>
+#include <chrono>
 
 #include "Structs.h"
 
@@ -19,6 +20,15 @@
 #include "camera.h"
 #include "Pipeline.h"
 #include "Object.h"
+#include "LoaderPool.h"
+#include "MeshRegistry.h"
+#include "DeviceAllocator.h"
+#include "UploadBatch.h"
+#include "MeshArena.h"
+#include "FrameAllocator.h"
+#include "TextureManager.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
 
 
 //enable validationLayers while on debug mode
@@ -66,8 +76,10 @@ private:
     VkDevice m_LogicalDevice = VK_NULL_HANDLE;
     VkQueue m_GraphicsQueue;
     VkQueue m_PresentQueue;
+    VkQueue m_TransferQueue{ VK_NULL_HANDLE }; //only with a transfer only queue family
     const std::vector<const char*> m_vDeviceExtensions = {
-                                                        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+                                                        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+                                                        VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME //bindless texture array (TextureManager)
                                                        };
     VkSwapchainKHR m_SwapChain;
     std::vector <VkImage> m_vSwapChainImages;
@@ -81,9 +93,10 @@ private:
 
 
    VkCommandPool m_CommandPool;
+   VkCommandPool m_TransferCommandPool{ VK_NULL_HANDLE };
+   UploadQueues m_UploadQueues; //filled in createCommandPool
   
     //const std::string m_ModelPath{ "models/room.obj" };
-    const std::string m_TexturePath{ "textures/viking_room.png" };
 
 
     std::vector < VkSemaphore> m_vImageAvailableSemaphores;
@@ -93,29 +106,35 @@ private:
     std::vector<VkCommandBuffer> m_vCommandBuffers;
     std::vector<VkCommandBuffer> m_vCommandBuffers2D;
     std::vector<VkBuffer> m_vUniformBuffers;
-    std::vector<VkDeviceMemory> m_vUniformBuffersMemory;
+    std::vector<DeviceAllocation> m_vUniformBuffersAllocation;
     std::vector<void*> m_vUniformBuffersMapped;
+    std::unique_ptr<FrameAllocator> m_pFrameAllocator; //per draw data off the frames in flight
     VkDescriptorPool m_DescriptorPool;
     std::vector<VkDescriptorSet> m_vDescriptorSets;
 
-    uint32_t m_MipLvl;
+    //cold start builds the mips on the cpu (stb_image_resize2, gamma correct, cooked into the texture cache)
+    //false blits them on the graphics queue and skips the cache, formats without linear blits always go the cpu way
+    bool m_IsCpuMipmaps{ true };
+    //BC1 (opaque) or BC3 blocks off every mip, cooked into the texture cache. Falls back to rgba8 when the device can not sample them
+    bool m_IsTextureCompressed{ true };
+    //per load timings and stats off the meshes and textures on stdout (see LoadLog)
+    bool m_IsVerboseLoadLog{ false };
     VkSampleCountFlagBits m_MsaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
-    VkImage m_TextureImage;
-    VkDeviceMemory m_TextureImageMemory;
-    VkImageView m_TextureImageView;
     VkSampler m_TextureSampler;
+    std::unique_ptr<TextureManager> m_pTextureManager;
 
     VkImage m_DepthImage;
-    VkDeviceMemory m_DepthImageMemory;
+    DeviceAllocation m_DepthImageAllocation;
     VkImageView m_DepthImageView;
 
     VkImage m_ColorImage;
-    VkDeviceMemory m_ColorImageMemory;
+    DeviceAllocation m_ColorImageAllocation;
     VkImageView m_ColorImageView;
 
     std::unique_ptr<Camera> m_pCamera;
     std::unique_ptr<Pipeline> m_p3DPipeline;
+    std::unique_ptr<Pipeline> m_pPacked3DPipeline;
     std::unique_ptr<SceneObject> m_p3DObject;
     std::unique_ptr<SceneObject> m_p3DObject2;
 
@@ -136,6 +155,20 @@ private:
     std::unique_ptr<Pipeline> m_p2DPipeline;
     std::unique_ptr<SceneObject> m_p2DObject;
     std::unique_ptr<SceneObject> m_p2DOvalObject;
+    std::unique_ptr<LoaderPool> m_pLoaderPool;
+    MeshRegistry m_MeshRegistry; //scene objects with the same model share its buffers
+    std::unique_ptr<DeviceAllocator> m_pDeviceAllocator; //every buffer and image gets its memory from here
+    std::unique_ptr<StagingRing> m_pStagingRing; //every upload stages through this one mapped buffer
+    std::unique_ptr<MeshArena> m_pMeshArena; //vertex and index ranges off every mesh
+    std::shared_ptr<UploadBatch> m_pUploadBatch;                         //still recording
+    std::vector<std::shared_ptr<UploadBatch>> m_vSubmittedUploadBatches; //in flight
+    bool m_HasPrintedMemoryStats{ false };
+    bool m_HasMemoryBudget{ false }; //VK_EXT_memory_budget got enabled
+    //device local bytes this instance tries to stay under (several run on one machine), 0 turns it off
+    VkDeviceSize m_SoftMemoryBudget{ 1ull << 30 };
+    bool m_IsOverMemoryBudget{ false };
+    std::chrono::steady_clock::time_point m_LastMemoryLog{};
+    const float m_MemoryLogInterval{ 10.f }; //seconds between the memory budget lines
 
 
     //gloabal variables for keeping track off rendering frames and the max off frames to deal with
@@ -218,6 +251,10 @@ private:
     void createCommandPool();
     void createCommandBuffers(std::vector<VkCommandBuffer>& commandBuffers);
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, Pipeline* pipeline, SceneObject* object);
+    //uploads/finishes the scene objects that are still loading, never blocks
+    void updateResidency();
+    //one line with the memory per category and heap (and the driver budget when known), every m_MemoryLogInterval
+    void logMemoryBudget();
     void drawFrame();
 
     //SEMAPHORE AND FENCE
@@ -225,7 +262,6 @@ private:
 
     //BUFFERS
     //void createVertexBuffer();
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     //void createIndexBuffer();
     void createUniformBuffers();
     void createDescriptorPool();
@@ -236,7 +272,8 @@ private:
     void createBuffer(VkDeviceSize bufferSize, 
         VkBufferUsageFlags flags,
         VkMemoryPropertyFlags memryProps, 
-        VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory);
+        VkBuffer& vertexBuffer, DeviceAllocation& vertexBufferAllocation,
+        MemoryCategory category);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
     private:
@@ -246,23 +283,32 @@ private:
 
     //UPDATE
     void updateUniformBuffer(uint32_t currentImage);
+    glm::mat4 getSceneModelMatrix()const;
 
     //TEXTURES
-    void createTextureImage();
+    //slots off the textures in the TextureManager array (one per path). The paths that are new get decoded/cooked in parallel
+    //on the loader pool straight into staging memory and recorded into the open upload batch, nothing waits on the gpu
+    std::vector<uint32_t> loadTextures(const std::vector<std::string>& vTexturePaths);
+    //every level off staging (offsets from pMips) in one copy, the image ends up in SHADER_READ_ONLY_OPTIMAL
+    void uploadTexture(const TextureCacheMip* pMips, uint32_t mipCount, const StagingRegion& staging, VkFormat format,
+        VkImage& image, DeviceAllocation& allocation);
+    void createDefaultTexture();
     void createImage(uint32_t width, uint32_t height, uint32_t mipLvls, VkSampleCountFlagBits numSamples,
                      VkFormat format, VkImageTiling tiling,
                      VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-                     VkImage& image, VkDeviceMemory& imageMemory);
-    void createTextureImageView();
+                     VkImage& image, DeviceAllocation& imageAllocation, MemoryCategory category);
     void createTextureSampler();
     void createDepthResources();//for all depth resources
     void createColorResources();// for all multisampling resources
+    //prints how much off the msaa color and depth memory never had to be committed (lazily allocated memory)
+    void reportTransientAttachments();
 
     //helper functions
-    VkCommandBuffer beginSingleCommands();
-    void endSingleCommands(VkCommandBuffer commandBuffer);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    void transitionImageLayout(VkImage image, VkFormat format, 
+    //the batch uploads record into until the next flushUploads, created on first use
+    const std::shared_ptr<UploadBatch>& getUploadBatch();
+    //submits the open batch once (if anything got recorded) and lets go off the batches that finished
+    void flushUploads();
+    void transitionImageLayout(VkCommandBuffer commandbuffer, VkImage image, VkFormat format, 
                                 VkImageLayout oldLayout, VkImageLayout newLayout,
                                 uint32_t mipLvls);
 
@@ -270,7 +316,12 @@ private:
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     VkFormat findDepthFormat();
     bool hasStencilComponent(VkFormat format);
-    void generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+    void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+    bool canBlitMipmaps(VkFormat format);
+    bool canSampleTexture(VkFormat format);
+    //upload mip 0 and blit the rest, the path from before the texture cache
+    void uploadBlitMipmappedTexture(const StagingRegion& staging, uint32_t width, uint32_t height, VkFormat format,
+        VkImage& image, DeviceAllocation& allocation, uint32_t& mipCount);
     VkSampleCountFlagBits getMaxUsableSampleCount();
 
 };
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+#include <atomic>
+
+//Per load timings and stats on stdout (obj parse and build, cache hits, lods, optimize, textures), for working on the loaders.
+//Off by default, a normal run only prints warnings and the memory reports. Read from the LoaderPool workers, so it is atomic
+class LoadLog
+{
+public:
+    static bool IsVerbose() { return s_IsVerbose.load(std::memory_order_relaxed); };
+    static void SetVerbose(bool isVerbose) { s_IsVerbose.store(isVerbose, std::memory_order_relaxed); };
+
+private:
+    static inline std::atomic<bool> s_IsVerbose{ false };
+};
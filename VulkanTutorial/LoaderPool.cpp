@@ -0,0 +1,58 @@
+#include "LoaderPool.h"
+
+
+LoaderPool::LoaderPool(unsigned int numThreads)
+{
+    if (numThreads == 0)
+    {
+        //hardware_concurrency() is 0 when it can not be detected, leave one core for the render thread
+        const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (unsigned int i{}; i < numThreads; ++i)
+        m_vWorkers.emplace_back(&LoaderPool::workerLoop, this);
+}
+
+LoaderPool::~LoaderPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_IsStopping = true;
+        m_Jobs.clear();
+    }
+    m_JobAdded.notify_all();
+
+    for (auto& worker : m_vWorkers)
+        worker.join();
+}
+
+std::future<void> LoaderPool::Submit(std::function<void()> job)
+{
+    std::packaged_task<void()> task{ std::move(job) };
+    std::future<void> future = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_Jobs.push_back(std::move(task));
+    }
+    m_JobAdded.notify_one();
+    return future;
+}
+
+void LoaderPool::workerLoop()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{ m_Mutex };
+            m_JobAdded.wait(lock, [this]() { return m_IsStopping || !m_Jobs.empty(); });
+            if (m_IsStopping)
+                return;
+
+            task = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+        }
+        task(); //exceptions end up in the future
+    }
+}
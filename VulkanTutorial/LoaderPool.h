@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+//Fixed size thread pool for the cpu side off loading assets (parsing, dedup, lods, optimizing)
+//Vulkan calls stay on the render thread, jobs only fill cpu memory
+class LoaderPool
+{
+public:
+    //numThreads = 0 uses all hardware threads but one, so the render thread keeps a core
+    explicit LoaderPool(unsigned int numThreads = 0);
+    //jobs that did not start yet get dropped (their futures report a broken promise), running ones are waited for
+    ~LoaderPool();
+
+    LoaderPool(const LoaderPool&) = delete;
+    LoaderPool& operator=(const LoaderPool&) = delete;
+
+    std::future<void> Submit(std::function<void()> job);
+
+private:
+    std::vector<std::thread> m_vWorkers;
+    std::deque<std::packaged_task<void()>> m_Jobs;
+    std::mutex m_Mutex;
+    std::condition_variable m_JobAdded;
+    bool m_IsStopping{ false };
+
+    void workerLoop();
+};
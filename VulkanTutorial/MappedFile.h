@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+//Read only memory mapping off a whole file (CreateFileMapping on windows, mmap elsewhere)
+//The mapping stays valid until Close() or destruction
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); };
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen()const { return m_pData != nullptr; };
+    const uint8_t* GetData()const { return m_pData; };
+    size_t GetSize()const { return m_Size; };
+
+private:
+    const uint8_t* m_pData{ nullptr };
+    size_t m_Size{ 0 };
+
+#ifdef _WIN32
+    void* m_FileHandle{ nullptr };
+    void* m_MappingHandle{ nullptr };
+#else
+    int m_FileDescriptor{ -1 };
+#endif
+};
@@ -0,0 +1,130 @@
+#include "MeshArena.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+MeshArena::MeshArena(DeviceAllocator& allocator, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity, VkDeviceSize maxVertexCapacity, VkDeviceSize maxIndexCapacity)
+    : m_Allocator{ allocator }, m_VertexCapacity{ vertexCapacity }, m_IndexCapacity{ indexCapacity },
+    m_MaxVertexCapacity{ std::max(vertexCapacity, maxVertexCapacity) }, m_MaxIndexCapacity{ std::max(indexCapacity, maxIndexCapacity) }
+{
+}
+
+MeshArena::~MeshArena()
+{
+    for (Layout& layout : m_Layouts)
+    {
+        for (ArenaBuffer& arenaBuffer : layout.vVertexBuffers)
+            m_Allocator.DestroyBuffer(arenaBuffer.buffer, arenaBuffer.allocation);
+        for (ArenaBuffer& arenaBuffer : layout.vIndexBuffers)
+            m_Allocator.DestroyBuffer(arenaBuffer.buffer, arenaBuffer.allocation);
+    }
+}
+
+bool MeshArena::AllocateVertices(VertexFormat format, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset)
+{
+    //stride aligned, vertexOffset in the draw is offset / stride
+    return allocateRange(m_Layouts[static_cast<size_t>(format)].vVertexBuffers, size, GetVertexStride(format), m_VertexCapacity, m_MaxVertexCapacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, buffer, offset);
+}
+
+bool MeshArena::AllocateIndices(VertexFormat format, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset)
+{
+    return allocateRange(m_Layouts[static_cast<size_t>(format)].vIndexBuffers, size, sizeof(uint32_t), m_IndexCapacity, m_MaxIndexCapacity,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, buffer, offset);
+}
+
+void MeshArena::FreeVertices(VertexFormat format, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    releaseRange(m_Layouts[static_cast<size_t>(format)].vVertexBuffers, buffer, offset, size);
+}
+
+void MeshArena::FreeIndices(VertexFormat format, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    releaseRange(m_Layouts[static_cast<size_t>(format)].vIndexBuffers, buffer, offset, size);
+}
+
+VkDeviceSize MeshArena::GetUsedBytes()const
+{
+    VkDeviceSize usedBytes{ GetCapacityBytes() };
+    for (const Layout& layout : m_Layouts)
+    {
+        for (const auto* pBuffers : { &layout.vVertexBuffers, &layout.vIndexBuffers })
+            for (const ArenaBuffer& arenaBuffer : *pBuffers)
+                for (const FreeRange& range : arenaBuffer.vFreeRanges)
+                    usedBytes -= range.size;
+    }
+    return usedBytes;
+}
+
+VkDeviceSize MeshArena::GetCapacityBytes()const
+{
+    VkDeviceSize capacityBytes{ 0 };
+    for (const Layout& layout : m_Layouts)
+    {
+        for (const auto* pBuffers : { &layout.vVertexBuffers, &layout.vIndexBuffers })
+            for (const ArenaBuffer& arenaBuffer : *pBuffers)
+                capacityBytes += arenaBuffer.capacity;
+    }
+    return capacityBytes;
+}
+
+uint32_t MeshArena::GetBufferCount()const
+{
+    size_t bufferCount{ 0 };
+    for (const Layout& layout : m_Layouts)
+        bufferCount += layout.vVertexBuffers.size() + layout.vIndexBuffers.size();
+    return static_cast<uint32_t>(bufferCount);
+}
+
+VkDeviceSize MeshArena::GetVertexStride(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Float3D:  return sizeof(Vertex3D);
+    case VertexFormat::Packed3D: return sizeof(Vertex3DPacked);
+    case VertexFormat::Float2D:  return sizeof(Vertex2D);
+    case VertexFormat::Packed2D: return sizeof(Vertex2DPacked);
+    }
+    throw std::runtime_error("unknown vertex format");
+}
+
+bool MeshArena::allocateRange(std::vector<ArenaBuffer>& vBuffers, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize initialCapacity, VkDeviceSize maxCapacity,
+    VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceSize& offset)
+{
+    for (ArenaBuffer& arenaBuffer : vBuffers)
+    {
+        if (DeviceAllocator::AllocateRange(arenaBuffer.vFreeRanges, size, alignment, offset))
+        {
+            buffer = arenaBuffer.buffer;
+            return true;
+        }
+    }
+
+    //twice the last one so a growing scene needs few buffers (and binds), but at least big enough for this range
+    //the capacity gets rounded down to whole vertices so a range never runs past the end
+    VkDeviceSize capacity = vBuffers.empty() ? initialCapacity : std::min(maxCapacity, vBuffers.back().capacity * 2);
+    while (capacity < size && capacity < maxCapacity)
+        capacity = std::min(maxCapacity, capacity * 2);
+    capacity = capacity / alignment * alignment;
+    if (capacity < size)
+        return false;
+
+    ArenaBuffer arenaBuffer{};
+    arenaBuffer.capacity    = capacity;
+    arenaBuffer.vFreeRanges = { FreeRange{ 0, capacity } };
+    m_Allocator.CreateBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        arenaBuffer.buffer, arenaBuffer.allocation, MemoryCategory::Mesh);
+    DeviceAllocator::AllocateRange(arenaBuffer.vFreeRanges, size, alignment, offset);
+    buffer = arenaBuffer.buffer;
+    vBuffers.push_back(std::move(arenaBuffer));
+    return true;
+}
+
+void MeshArena::releaseRange(std::vector<ArenaBuffer>& vBuffers, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    //buffers are kept until the arena goes, a frame in flight can still draw from an emptied one
+    auto it = std::find_if(vBuffers.begin(), vBuffers.end(), [buffer](const ArenaBuffer& arenaBuffer) { return arenaBuffer.buffer == buffer; });
+    if (it == vBuffers.end())
+        throw std::runtime_error("freed a range that is not in the mesh arena");
+    DeviceAllocator::ReleaseRange(it->vFreeRanges, offset, size);
+}
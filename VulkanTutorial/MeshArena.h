@@ -0,0 +1,78 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include "DeviceAllocator.h"
+#include <vector>
+
+//Shared device local vertex and index buffers per vertex layout (created on first use).
+//Every mesh owns a range off them and draws with vertexOffset/firstIndex, so all meshes in one buffer
+//render with a single vertex and index buffer bind. The index buffers hold 16 and 32 bit ranges side by side,
+//ranges are 4 byte aligned so firstIndex works with both index types off the same binding.
+//A layout starts with small buffers and adds one twice as big (up to the max size) whenever a mesh does not fit,
+//the existing ranges never move so nothing has to be copied or rebound
+class MeshArena
+{
+public:
+    //initial sizes off the first vertex/index buffer off a layout, max sizes cap the ones added later
+    MeshArena(DeviceAllocator& allocator, VkDeviceSize vertexCapacity = m_DefaultVertexCapacity, VkDeviceSize indexCapacity = m_DefaultIndexCapacity,
+        VkDeviceSize maxVertexCapacity = m_DefaultMaxVertexCapacity, VkDeviceSize maxIndexCapacity = m_DefaultMaxIndexCapacity);
+    ~MeshArena();
+
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    //false when the range is bigger than the max buffer size, the mesh keeps its own buffers then
+    //buffer receives the arena buffer the range is in, offsets are in bytes
+    bool AllocateVertices(VertexFormat format, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+    bool AllocateIndices(VertexFormat format, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+    void FreeVertices(VertexFormat format, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+    void FreeIndices(VertexFormat format, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+
+    VkDeviceSize GetUsedBytes()const;
+    //everything the arena buffers take, used or not
+    VkDeviceSize GetCapacityBytes()const;
+    uint32_t GetBufferCount()const;
+
+    static VkDeviceSize GetVertexStride(VertexFormat format);
+
+private:
+    struct ArenaBuffer
+    {
+        VkBuffer buffer{ VK_NULL_HANDLE };
+        DeviceAllocation allocation;
+        VkDeviceSize capacity{ 0 };
+        std::vector<FreeRange> vFreeRanges;
+    };
+    struct Layout
+    {
+        std::vector<ArenaBuffer> vVertexBuffers; //in creation order, each one at least as big as the one before
+        std::vector<ArenaBuffer> vIndexBuffers;
+    };
+
+    static constexpr VkDeviceSize m_DefaultVertexCapacity{ 4ull << 20 };
+    static constexpr VkDeviceSize m_DefaultIndexCapacity{ 2ull << 20 };
+    static constexpr VkDeviceSize m_DefaultMaxVertexCapacity{ 64ull << 20 };
+    static constexpr VkDeviceSize m_DefaultMaxIndexCapacity{ 32ull << 20 };
+    static constexpr size_t m_LayoutCount{ 4 };
+
+    DeviceAllocator& m_Allocator;
+    VkDeviceSize m_VertexCapacity;
+    VkDeviceSize m_IndexCapacity;
+    VkDeviceSize m_MaxVertexCapacity;
+    VkDeviceSize m_MaxIndexCapacity;
+    Layout m_Layouts[m_LayoutCount];
+
+    //first fit over the buffers, adds a bigger one when none has room
+    bool allocateRange(std::vector<ArenaBuffer>& vBuffers, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize initialCapacity, VkDeviceSize maxCapacity,
+        VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceSize& offset);
+    static void releaseRange(std::vector<ArenaBuffer>& vBuffers, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+};
+
+//what is bound on a command buffer while recording, so consecutive meshes off one arena skip the rebinds
+struct MeshBindState
+{
+    VkBuffer vertexBuffer{ VK_NULL_HANDLE };
+    VkBuffer indexBuffer{ VK_NULL_HANDLE };
+    VkIndexType indexType{ VK_INDEX_TYPE_MAX_ENUM };
+};
@@ -0,0 +1,185 @@
+#include "MeshCache.h"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+
+bool MeshCache::Open(const std::string& modelPath, uint32_t importFlags)
+{
+    Close();
+
+    uint64_t sourceSize{};
+    int64_t sourceTime{};
+    if (!getSourceStamp(modelPath, sourceSize, sourceTime))
+        return false;
+
+    if (!m_File.Open(GetCachePath(modelPath, importFlags)))
+        return false;
+
+    //validate everything before handing out pointers into the mapping
+    const size_t fileSize = m_File.GetSize();
+    if (fileSize < sizeof(MeshCacheHeader))
+    {
+        m_File.Close();
+        return false;
+    }
+
+    const MeshCacheHeader* pHeader = reinterpret_cast<const MeshCacheHeader*>(m_File.GetData());
+    const uint64_t vertexBytes = uint64_t(pHeader->vertexCount) * sizeof(Vertex3D);
+    const uint64_t indexBytes  = uint64_t(pHeader->indexCount) * sizeof(uint32_t);
+    const uint64_t lodBytes    = uint64_t(pHeader->lodCount) * sizeof(MeshLod);
+    const uint64_t submeshBytes = uint64_t(pHeader->lodCount) * pHeader->submeshCount * sizeof(Submesh);
+
+    bool isValid = pHeader->magic == Magic
+        && pHeader->version == Version
+        && pHeader->importFlags == importFlags
+        && pHeader->vertexStride == sizeof(Vertex3D)
+        && pHeader->sourceSize == sourceSize
+        && pHeader->sourceTime == sourceTime
+        && pHeader->pathLength == modelPath.size()
+        && sizeof(MeshCacheHeader) + pHeader->pathLength <= fileSize
+        && pHeader->lodOffset % alignof(MeshLod) == 0
+        && pHeader->submeshOffset % alignof(Submesh) == 0
+        && pHeader->vertexOffset % alignof(Vertex3D) == 0
+        && pHeader->indexOffset % alignof(uint32_t) == 0
+        && pHeader->lodOffset + lodBytes <= fileSize
+        && pHeader->submeshOffset + submeshBytes <= fileSize
+        && pHeader->vertexOffset + vertexBytes <= fileSize
+        && pHeader->indexOffset + indexBytes <= fileSize;
+
+    if (isValid)
+        isValid = memcmp(m_File.GetData() + sizeof(MeshCacheHeader), modelPath.data(), modelPath.size()) == 0;
+
+    //every lod has to stay inside the index section
+    const MeshLod* pLods = reinterpret_cast<const MeshLod*>(m_File.GetData() + pHeader->lodOffset);
+    for (uint32_t lod{}; isValid && lod < pHeader->lodCount; ++lod)
+        isValid = uint64_t(pLods[lod].firstIndex) + pLods[lod].indexCount <= pHeader->indexCount;
+
+    //same for the submeshes
+    const Submesh* pSubmeshes = reinterpret_cast<const Submesh*>(m_File.GetData() + pHeader->submeshOffset);
+    for (uint64_t submesh{}; isValid && submesh < uint64_t(pHeader->lodCount) * pHeader->submeshCount; ++submesh)
+        isValid = uint64_t(pSubmeshes[submesh].firstIndex) + pSubmeshes[submesh].indexCount <= pHeader->indexCount;
+
+    if (!isValid)
+    {
+        m_File.Close();
+        return false;
+    }
+
+    m_pHeader = pHeader;
+    return true;
+}
+
+void MeshCache::Close()
+{
+    m_File.Close();
+    m_pHeader = nullptr;
+}
+
+bool MeshCache::Write(const std::string& modelPath, uint32_t importFlags,
+    const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods,
+    const std::vector<Submesh>& submeshes)
+{
+    if (lods.empty() || submeshes.size() % lods.size() != 0)
+        return false;
+
+    MeshCacheHeader header{};
+    if (!getSourceStamp(modelPath, header.sourceSize, header.sourceTime))
+        return false;
+
+    auto alignUp = [](uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; };
+
+    header.magic        = Magic;
+    header.version      = Version;
+    header.importFlags  = importFlags;
+    header.vertexStride = sizeof(Vertex3D);
+    header.pathLength   = static_cast<uint32_t>(modelPath.size());
+    header.vertexCount  = static_cast<uint32_t>(vertices.size());
+    header.indexCount   = static_cast<uint32_t>(indices.size());
+    header.lodCount     = static_cast<uint32_t>(lods.size());
+    header.submeshCount = static_cast<uint32_t>(submeshes.size() / lods.size());
+    header.lodOffset    = alignUp(sizeof(MeshCacheHeader) + header.pathLength, 16);
+    header.submeshOffset = alignUp(header.lodOffset + lods.size() * sizeof(MeshLod), 16);
+    header.vertexOffset = alignUp(header.submeshOffset + submeshes.size() * sizeof(Submesh), 16);
+    header.indexOffset  = alignUp(header.vertexOffset + vertices.size() * sizeof(Vertex3D), 16);
+
+    //write next to the final file and swap it in, so a crash never leaves a half written cache behind
+    //the temp name is per thread, two loads off the same mesh on the LoaderPool must not write into one file
+    const std::string cachePath = GetCachePath(modelPath, importFlags);
+    std::ostringstream tempName;
+    tempName << cachePath << "." << std::this_thread::get_id() << ".tmp";
+    const std::string tempPath  = tempName.str();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        const char zeros[16]{};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(modelPath.data(), modelPath.size());
+        file.write(zeros, header.lodOffset - (sizeof(MeshCacheHeader) + header.pathLength));
+        file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(MeshLod));
+        file.write(zeros, header.submeshOffset - (header.lodOffset + lods.size() * sizeof(MeshLod)));
+        file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(Submesh));
+        file.write(zeros, header.vertexOffset - (header.submeshOffset + submeshes.size() * sizeof(Submesh)));
+        file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex3D));
+        file.write(zeros, header.indexOffset - (header.vertexOffset + vertices.size() * sizeof(Vertex3D)));
+        file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string& modelPath, uint32_t importFlags)
+{
+    std::ostringstream path;
+    path << modelPath << "." << std::hex << importFlags << ".meshcache";
+    return path.str();
+}
+
+const Vertex3D* MeshCache::GetVertices()const
+{
+    return reinterpret_cast<const Vertex3D*>(m_File.GetData() + m_pHeader->vertexOffset);
+}
+
+const uint32_t* MeshCache::GetIndices()const
+{
+    return reinterpret_cast<const uint32_t*>(m_File.GetData() + m_pHeader->indexOffset);
+}
+
+const MeshLod* MeshCache::GetLods()const
+{
+    return reinterpret_cast<const MeshLod*>(m_File.GetData() + m_pHeader->lodOffset);
+}
+
+const Submesh* MeshCache::GetSubmeshes()const
+{
+    return reinterpret_cast<const Submesh*>(m_File.GetData() + m_pHeader->submeshOffset);
+}
+
+bool MeshCache::getSourceStamp(const std::string& modelPath, uint64_t& size, int64_t& time)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(modelPath, error);
+    if (error)
+        return false;
+
+    auto writeTime = std::filesystem::last_write_time(modelPath, error);
+    if (error)
+        return false;
+
+    time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+//Binary file layout:
+//  MeshCacheHeader | source path (pathLength bytes) | lods (lodOffset) | submeshes (submeshOffset, lodCount * submeshCount)
+//  | vertices (vertexOffset) | indices (indexOffset)
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t importFlags;  //loader options that change the output
+    uint32_t vertexStride; //sizeof(Vertex3D) off the writer
+    uint64_t sourceSize;   //size and last write time off the .obj it was build from
+    int64_t  sourceTime;
+    uint32_t pathLength;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t submeshCount; //per lod
+    uint32_t padding;
+    uint64_t lodOffset;
+    uint64_t submeshOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+};
+
+//Deduplicated vertices and indices off a model, stored next to the .obj so warm starts skip parsing and hashing
+//Open() memory maps the file, the data is only valid until Close()
+class MeshCache
+{
+public:
+    static constexpr uint32_t Magic{ 0x434D4B56 }; //"VKMC"
+    static constexpr uint32_t Version{ 3 };
+
+    bool Open(const std::string& modelPath, uint32_t importFlags);
+    void Close();
+    static bool Write(const std::string& modelPath, uint32_t importFlags,
+        const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods,
+        const std::vector<Submesh>& submeshes);
+    //one file per import flags, Meshes off the same model with other flags would overwrite each other's cache otherwise
+    static std::string GetCachePath(const std::string& modelPath, uint32_t importFlags);
+
+    const Vertex3D* GetVertices()const;
+    const uint32_t* GetIndices()const;
+    const MeshLod* GetLods()const;
+    const Submesh* GetSubmeshes()const;
+    uint32_t GetVertexCount()const { return m_pHeader->vertexCount; };
+    uint32_t GetIndexCount()const { return m_pHeader->indexCount; };
+    uint32_t GetLodCount()const { return m_pHeader->lodCount; };
+    uint32_t GetSubmeshCount()const { return m_pHeader->submeshCount; };
+
+private:
+    MappedFile m_File;
+    const MeshCacheHeader* m_pHeader{ nullptr };
+
+    static bool getSourceStamp(const std::string& modelPath, uint64_t& size, int64_t& time);
+};
@@ -0,0 +1,271 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+
+
+//FIFO cache emulation with time stamps: a vertex is a hit while less than CacheSize misses happened since it got in
+class CacheSimulator
+{
+public:
+    explicit CacheSimulator(size_t vertexCount) : m_vTimeStamps(vertexCount, 0), m_Time{ MeshOptimizer::CacheSize + 1 } {};
+
+    bool IsInCache(uint32_t vertex)const { return m_Time - m_vTimeStamps[vertex] <= MeshOptimizer::CacheSize; };
+    uint32_t GetTime()const { return m_Time; };
+    uint32_t GetTimeStamp(uint32_t vertex)const { return m_vTimeStamps[vertex]; };
+
+    //returns true on a miss
+    bool Touch(uint32_t vertex)
+    {
+        if (IsInCache(vertex))
+            return false;
+        m_vTimeStamps[vertex] = m_Time++;
+        return true;
+    }
+    void Flush() { m_Time += MeshOptimizer::CacheSize + 1; };
+
+private:
+    std::vector<uint32_t> m_vTimeStamps;
+    uint32_t m_Time;
+};
+
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    //vertex -> triangles adjacency in one flat array
+    std::vector<uint32_t> vLiveTriangles(vertexCount, 0);
+    for (uint32_t index : indices)
+        ++vLiveTriangles[index];
+
+    std::vector<uint32_t> vAdjacencyOffsets(vertexCount + 1, 0);
+    for (size_t vertex{}; vertex < vertexCount; ++vertex)
+        vAdjacencyOffsets[vertex + 1] = vAdjacencyOffsets[vertex] + vLiveTriangles[vertex];
+
+    std::vector<uint32_t> vAdjacency(indices.size());
+    {
+        std::vector<uint32_t> vFill(vAdjacencyOffsets.begin(), vAdjacencyOffsets.end() - 1);
+        for (size_t i{}; i < indices.size(); ++i)
+            vAdjacency[vFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    CacheSimulator cache{ vertexCount };
+    std::vector<bool> vIsEmitted(triangleCount, false);
+    std::vector<uint32_t> vDeadEnds; //recently used vertices, tried first when the fan runs dry
+    std::vector<uint32_t> vCandidates;
+    std::vector<uint32_t> vOutput;
+    vOutput.reserve(indices.size());
+
+    size_t cursor{ 0 }; //next vertex to try in input order once the dead end stack is empty
+    int64_t fanVertex = indices[0];
+    while (fanVertex >= 0)
+    {
+        vCandidates.clear();
+        for (uint32_t adjacent{ vAdjacencyOffsets[fanVertex] }; adjacent < vAdjacencyOffsets[fanVertex + 1]; ++adjacent)
+        {
+            const uint32_t triangle = vAdjacency[adjacent];
+            if (vIsEmitted[triangle])
+                continue;
+
+            for (size_t corner{}; corner < 3; ++corner)
+            {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                vOutput.push_back(vertex);
+                vDeadEnds.push_back(vertex);
+                vCandidates.push_back(vertex);
+                --vLiveTriangles[vertex];
+                cache.Touch(vertex);
+            }
+            vIsEmitted[triangle] = true;
+        }
+
+        //pick the candidate that still has triangles left and will stay in the cache while we fan around it
+        int64_t bestVertex{ -1 };
+        int64_t bestPriority{ -1 };
+        for (uint32_t vertex : vCandidates)
+        {
+            if (vLiveTriangles[vertex] == 0)
+                continue;
+
+            int64_t priority{ 0 };
+            const int64_t age = int64_t(cache.GetTime()) - cache.GetTimeStamp(vertex);
+            if (age + 2 * int64_t(vLiveTriangles[vertex]) <= CacheSize)
+                priority = age;
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                bestVertex = vertex;
+            }
+        }
+
+        //dead end: go back to a recent vertex, or else the next one in input order
+        while (bestVertex < 0 && !vDeadEnds.empty())
+        {
+            const uint32_t vertex = vDeadEnds.back();
+            vDeadEnds.pop_back();
+            if (vLiveTriangles[vertex] > 0)
+                bestVertex = vertex;
+        }
+        while (bestVertex < 0 && cursor < vertexCount)
+        {
+            if (vLiveTriangles[cursor] > 0)
+                bestVertex = cursor;
+            ++cursor;
+        }
+        fanVertex = bestVertex;
+    }
+
+    indices.swap(vOutput);
+}
+
+size_t MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return 0;
+
+    //hard boundaries: triangles where all 3 vertices miss, the cache starts over there anyway
+    std::vector<size_t> vHardClusters;
+    {
+        CacheSimulator cache{ vertices.size() };
+        for (size_t triangle{}; triangle < triangleCount; ++triangle)
+        {
+            int misses{ 0 };
+            for (size_t corner{}; corner < 3; ++corner)
+                misses += cache.Touch(indices[triangle * 3 + corner]);
+            if (misses == 3)
+                vHardClusters.push_back(triangle);
+        }
+        if (vHardClusters.empty() || vHardClusters[0] != 0)
+            vHardClusters.insert(vHardClusters.begin(), 0);
+        vHardClusters.push_back(triangleCount);
+    }
+
+    //soft boundaries: split a hard cluster further wherever its ACMR so far stays close to the ACMR off the whole cluster
+    std::vector<size_t> vClusters;
+    for (size_t hard{}; hard + 1 < vHardClusters.size(); ++hard)
+    {
+        const size_t begin = vHardClusters[hard];
+        const size_t end   = vHardClusters[hard + 1];
+
+        CacheSimulator clusterCache{ vertices.size() };
+        size_t clusterMisses{ 0 };
+        for (size_t i{ begin * 3 }; i < end * 3; ++i)
+            clusterMisses += clusterCache.Touch(indices[i]);
+        const float clusterThreshold = threshold * float(clusterMisses) / float(end - begin);
+
+        CacheSimulator cache{ vertices.size() };
+        size_t start{ begin };
+        size_t misses{ 0 };
+        vClusters.push_back(begin);
+        for (size_t triangle{ begin }; triangle < end; ++triangle)
+        {
+            for (size_t corner{}; corner < 3; ++corner)
+                misses += cache.Touch(indices[triangle * 3 + corner]);
+
+            if (triangle + 1 < end && float(misses) / float(triangle + 1 - start) <= clusterThreshold)
+            {
+                vClusters.push_back(triangle + 1);
+                start = triangle + 1;
+                misses = 0;
+                cache.Flush();
+            }
+        }
+    }
+    vClusters.push_back(triangleCount);
+    const size_t clusterCount = vClusters.size() - 1;
+
+    //sort key: how much the cluster faces away from the mesh center (area weighted centroid and normal)
+    glm::vec3 meshCentroid{ 0.f };
+    float meshArea{ 0.f };
+    std::vector<float> vSortKeys(clusterCount);
+    std::vector<glm::vec3> vCentroids(clusterCount);
+    std::vector<glm::vec3> vNormals(clusterCount);
+    for (size_t cluster{}; cluster < clusterCount; ++cluster)
+    {
+        glm::vec3 centroid{ 0.f };
+        glm::vec3 normal{ 0.f };
+        float area{ 0.f };
+        for (size_t triangle{ vClusters[cluster] }; triangle < vClusters[cluster + 1]; ++triangle)
+        {
+            const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].pos;
+            const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(cross);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+
+        vCentroids[cluster] = area > 0.f ? centroid / area : centroid;
+        const float normalLength = glm::length(normal);
+        vNormals[cluster] = normalLength > 0.f ? normal / normalLength : normal;
+    }
+    if (meshArea > 0.f)
+        meshCentroid /= meshArea;
+
+    for (size_t cluster{}; cluster < clusterCount; ++cluster)
+        vSortKeys[cluster] = glm::dot(vCentroids[cluster] - meshCentroid, vNormals[cluster]);
+
+    std::vector<size_t> vOrder(clusterCount);
+    std::iota(vOrder.begin(), vOrder.end(), 0);
+    std::stable_sort(vOrder.begin(), vOrder.end(), [&](size_t a, size_t b) { return vSortKeys[a] > vSortKeys[b]; });
+
+    std::vector<uint32_t> vOutput;
+    vOutput.reserve(indices.size());
+    for (size_t cluster : vOrder)
+        vOutput.insert(vOutput.end(), indices.begin() + vClusters[cluster] * 3, indices.begin() + vClusters[cluster + 1] * 3);
+
+    indices.swap(vOutput);
+    return clusterCount;
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex3D>& vertices)
+{
+    constexpr uint32_t unused{ 0xFFFFFFFF };
+    std::vector<uint32_t> vRemap(vertices.size(), unused);
+    std::vector<Vertex3D> vOutput;
+    vOutput.reserve(vertices.size());
+
+    for (uint32_t& index : indices)
+    {
+        if (vRemap[index] == unused)
+        {
+            vRemap[index] = static_cast<uint32_t>(vOutput.size());
+            vOutput.push_back(vertices[index]);
+        }
+        index = vRemap[index];
+    }
+
+    vertices.swap(vOutput);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    VertexCacheStats stats{};
+    if (indices.empty())
+        return stats;
+
+    CacheSimulator cache{ vertexCount };
+    std::vector<bool> vIsReferenced(vertexCount, false);
+    size_t referencedCount{ 0 };
+    for (uint32_t index : indices)
+    {
+        stats.misses += cache.Touch(index);
+        if (!vIsReferenced[index])
+        {
+            vIsReferenced[index] = true;
+            ++referencedCount;
+        }
+    }
+
+    stats.acmr = float(stats.misses) / float(indices.size() / 3);
+    stats.atvr = float(stats.misses) / float(referencedCount);
+    return stats;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+//post transform cache numbers off an index buffer (simulated FIFO cache)
+struct VertexCacheStats
+{
+    uint32_t misses{ 0 };
+    float acmr{ 0.f }; //average cache miss ratio: misses per triangle, 0.5 is the best a regular mesh can get
+    float atvr{ 0.f }; //average transformed vertex ratio: misses per referenced vertex, 1.0 is optimal
+};
+
+//Reorders triangle list indices/vertices off a mesh for the GPU, the mesh itself stays the same
+//Run them in order: OptimizeVertexCache -> OptimizeOverdraw -> OptimizeVertexFetch
+class MeshOptimizer
+{
+public:
+    static constexpr uint32_t CacheSize{ 16 };
+
+    //Tipsify (Sander et al. 2007): fans triangles around the vertex that is most likely still in the cache
+    static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    //Splits the cache optimized triangles in clusters (as long as the ACMR stays within threshold)
+    //and draws the clusters that face outwards first, so the depth test can reject more off the rest
+    //returns the amount off clusters
+    static size_t OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, float threshold = 1.05f);
+
+    //Puts the vertices in the order the indices first use them and drops unused ones
+    static void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex3D>& vertices);
+
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+};
@@ -0,0 +1,37 @@
+#include "MeshRegistry.h"
+
+
+std::shared_ptr<Mesh> MeshRegistry::Acquire(const std::string& modelPath, bool isColored, ObjLoadMode loadMode,
+    bool optimizeMesh, uint32_t lodCount, VertexFormat vertexFormat)
+{
+    //constructing a Mesh does no loading, so it is fine to build one just for the key
+    auto pMesh = std::make_shared<Mesh>(modelPath, isColored, loadMode, optimizeMesh, lodCount, vertexFormat);
+    const std::string key = getKey(*pMesh);
+
+    auto it = m_Meshes.find(key);
+    if (it != m_Meshes.end())
+        return it->second;
+
+    m_Meshes.emplace(key, pMesh);
+    return pMesh;
+}
+
+void MeshRegistry::Release(std::shared_ptr<Mesh>& pMesh)
+{
+    if (!pMesh)
+        return;
+
+    auto it = m_Meshes.find(getKey(*pMesh));
+    pMesh.reset();
+    if (it == m_Meshes.end() || it->second.use_count() > 1)
+        return;
+
+    it->second->Destroy();
+    m_Meshes.erase(it);
+}
+
+std::string MeshRegistry::getKey(const Mesh& mesh)
+{
+    //the load mode is left out on purpose, every mode builds the same mesh
+    return mesh.GetModelPath() + '|' + std::to_string(mesh.GetImportFlags()) + '|' + std::to_string(static_cast<int>(mesh.GetVertexFormat()));
+}
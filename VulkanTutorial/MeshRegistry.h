@@ -0,0 +1,23 @@
+#pragma once
+#include "Object.h"
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+//Hands out one shared Mesh per model path + import options, so a model placed N times is parsed, uploaded and allocated once
+//Only used from the render thread
+class MeshRegistry
+{
+public:
+    std::shared_ptr<Mesh> Acquire(const std::string& modelPath, bool isColored, ObjLoadMode loadMode = ObjLoadMode::Serial,
+        bool optimizeMesh = false, uint32_t lodCount = 1, VertexFormat vertexFormat = VertexFormat::Float3D);
+    //destroys the gpu data once the last SceneObject let go off it, pMesh is reset either way
+    void Release(std::shared_ptr<Mesh>& pMesh);
+
+    size_t GetMeshCount()const { return m_Meshes.size(); };
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<Mesh>> m_Meshes;
+
+    static std::string getKey(const Mesh& mesh);
+};
@@ -0,0 +1,424 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+
+//symmetric 4x4 matrix off the summed squared plane distances, w is the summed weight so the error is an average
+struct Quadric
+{
+    double a2{}, ab{}, ac{}, ad{};
+    double b2{}, bc{}, bd{};
+    double c2{}, cd{};
+    double d2{};
+    double w{};
+
+    void AddPlane(const glm::dvec3& normal, double distance, double weight)
+    {
+        a2 += weight * normal.x * normal.x; ab += weight * normal.x * normal.y; ac += weight * normal.x * normal.z; ad += weight * normal.x * distance;
+        b2 += weight * normal.y * normal.y; bc += weight * normal.y * normal.z; bd += weight * normal.y * distance;
+        c2 += weight * normal.z * normal.z; cd += weight * normal.z * distance;
+        d2 += weight * distance * distance;
+        w  += weight;
+    }
+
+    void Add(const Quadric& other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        w  += other.w;
+    }
+
+    //average squared distance off point to the planes
+    double Error(const glm::dvec3& p)const
+    {
+        const double error = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+            + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+            + c2 * p.z * p.z + 2 * cd * p.z
+            + d2;
+        return w > 0.0 ? std::max(0.0, error / w) : 0.0;
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+static bool isPositionLess(const glm::vec3& a, const glm::vec3& b)
+{
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    return a.z < b.z;
+}
+
+//wedge off toPosition that looks most like vertex, so seams keep their normals/uvs as good as possible
+static uint32_t findClosestWedge(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& vWedgeNext, uint32_t vertex, uint32_t toPosition)
+{
+    uint32_t best{ toPosition };
+    float bestDistance{ std::numeric_limits<float>::max() };
+    uint32_t wedge{ toPosition };
+    do
+    {
+        const float distance = (1.f - glm::dot(vertices[vertex].normal, vertices[wedge].normal))
+            + glm::length(vertices[vertex].texcoord - vertices[wedge].texcoord);
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            best = wedge;
+        }
+        wedge = vWedgeNext[wedge];
+    } while (wedge != toPosition);
+    return best;
+}
+
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices,
+    size_t targetIndexCount, float targetError, float& resultError)
+{
+    resultError = 0.f;
+    std::vector<uint32_t> vIndices = indices;
+    const size_t vertexCount = vertices.size();
+    if (vIndices.size() <= targetIndexCount || vertexCount == 0)
+        return vIndices;
+
+    //work in a unit box so the errors do not depend on the model scale
+    glm::vec3 minimum{ vertices[0].pos };
+    for (const Vertex3D& vertex : vertices)
+        minimum = glm::min(minimum, vertex.pos);
+    const float extent = std::max(GetExtent(vertices), 1e-12f);
+    std::vector<glm::dvec3> vPositions(vertexCount);
+    for (size_t vertex{}; vertex < vertexCount; ++vertex)
+        vPositions[vertex] = glm::dvec3(vertices[vertex].pos - minimum) / double(extent);
+
+    //vertices with the same position (normal/uv seams) get collapsed as one, the lowest index represents them
+    //vWedgeNext links all vertices off a position in a circle
+    std::vector<uint32_t> vPositionId(vertexCount);
+    std::vector<uint32_t> vWedgeNext(vertexCount);
+    {
+        std::vector<uint32_t> vSorted(vertexCount);
+        std::iota(vSorted.begin(), vSorted.end(), 0);
+        std::stable_sort(vSorted.begin(), vSorted.end(), [&](uint32_t a, uint32_t b) { return isPositionLess(vertices[a].pos, vertices[b].pos); });
+
+        for (size_t begin{}; begin < vertexCount;)
+        {
+            size_t end{ begin + 1 };
+            while (end < vertexCount && vertices[vSorted[end]].pos == vertices[vSorted[begin]].pos)
+                ++end;
+
+            const uint32_t representative = *std::min_element(vSorted.begin() + begin, vSorted.begin() + end);
+            for (size_t i{ begin }; i < end; ++i)
+            {
+                vPositionId[vSorted[i]] = representative;
+                vWedgeNext[vSorted[i]] = vSorted[i + 1 < end ? i + 1 : begin];
+            }
+            begin = end;
+        }
+    }
+
+    //plane quadrics off every triangle, weighted by area
+    std::vector<Quadric> vQuadrics(vertexCount);
+    for (size_t i{}; i < vIndices.size(); i += 3)
+    {
+        const uint32_t p0 = vPositionId[vIndices[i]], p1 = vPositionId[vIndices[i + 1]], p2 = vPositionId[vIndices[i + 2]];
+        const glm::dvec3 cross = glm::cross(vPositions[p1] - vPositions[p0], vPositions[p2] - vPositions[p0]);
+        const double area = glm::length(cross);
+        if (area <= 0.0)
+            continue;
+
+        const glm::dvec3 normal = cross / area;
+        const double distance = -glm::dot(normal, vPositions[p0]);
+        vQuadrics[p0].AddPlane(normal, distance, area);
+        vQuadrics[p1].AddPlane(normal, distance, area);
+        vQuadrics[p2].AddPlane(normal, distance, area);
+    }
+
+    //open borders get a plane perpendicular to the triangle along the edge, so they do not shrink
+    {
+        std::vector<std::pair<uint64_t, uint32_t>> vEdges; //(sorted position pair, triangle corner)
+        vEdges.reserve(vIndices.size());
+        for (size_t i{}; i < vIndices.size(); ++i)
+        {
+            const uint32_t a = vPositionId[vIndices[i]];
+            const uint32_t b = vPositionId[vIndices[i - i % 3 + (i + 1) % 3]];
+            vEdges.push_back({ (uint64_t(std::min(a, b)) << 32) | std::max(a, b), static_cast<uint32_t>(i) });
+        }
+        std::sort(vEdges.begin(), vEdges.end());
+
+        const double borderWeight{ 10.0 };
+        for (size_t i{}; i < vEdges.size(); ++i)
+        {
+            const bool isShared = (i > 0 && vEdges[i - 1].first == vEdges[i].first) || (i + 1 < vEdges.size() && vEdges[i + 1].first == vEdges[i].first);
+            if (isShared)
+                continue;
+
+            const size_t corner = vEdges[i].second;
+            const size_t triangle = corner - corner % 3;
+            const uint32_t a = vPositionId[vIndices[corner]];
+            const uint32_t b = vPositionId[vIndices[triangle + (corner + 1) % 3]];
+            const uint32_t c = vPositionId[vIndices[triangle + (corner + 2) % 3]];
+
+            const glm::dvec3 edge = vPositions[b] - vPositions[a];
+            const glm::dvec3 faceNormal = glm::cross(edge, vPositions[c] - vPositions[a]);
+            glm::dvec3 normal = glm::cross(edge, faceNormal);
+            const double length = glm::length(normal);
+            if (length <= 0.0)
+                continue;
+
+            normal /= length;
+            const double distance = -glm::dot(normal, vPositions[a]);
+            const double weight = borderWeight * glm::dot(edge, edge);
+            vQuadrics[a].AddPlane(normal, distance, weight);
+            vQuadrics[b].AddPlane(normal, distance, weight);
+        }
+    }
+
+    const double maxError = double(targetError) * double(targetError);
+    std::vector<uint32_t> vAdjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> vAdjacency;
+    std::vector<Collapse> vCollapses;
+    std::vector<bool> vIsLocked(vertexCount);
+    std::vector<uint32_t> vCollapseTo(vertexCount);
+    std::iota(vCollapseTo.begin(), vCollapseTo.end(), 0);
+
+    //every pass does a batch off the cheapest independent collapses, then rebuilds the triangle list
+    while (vIndices.size() > targetIndexCount)
+    {
+        //position -> triangles
+        std::fill(vAdjacencyOffsets.begin(), vAdjacencyOffsets.end(), 0);
+        for (uint32_t index : vIndices)
+            ++vAdjacencyOffsets[vPositionId[index] + 1];
+        std::partial_sum(vAdjacencyOffsets.begin(), vAdjacencyOffsets.end(), vAdjacencyOffsets.begin());
+        vAdjacency.resize(vIndices.size());
+        {
+            std::vector<uint32_t> vFill(vAdjacencyOffsets.begin(), vAdjacencyOffsets.end() - 1);
+            for (size_t i{}; i < vIndices.size(); ++i)
+                vAdjacency[vFill[vPositionId[vIndices[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        //cheapest direction for every edge
+        vCollapses.clear();
+        for (size_t i{}; i < vIndices.size(); ++i)
+        {
+            const uint32_t a = vPositionId[vIndices[i]];
+            const uint32_t b = vPositionId[vIndices[i - i % 3 + (i + 1) % 3]];
+            if (a == b)
+                continue; //interior edges show up twice, the locks make sure only one off them collapses
+
+            Quadric quadric = vQuadrics[a];
+            quadric.Add(vQuadrics[b]);
+            const double errorToB = quadric.Error(vPositions[b]);
+            const double errorToA = quadric.Error(vPositions[a]);
+            if (errorToB <= errorToA)
+                vCollapses.push_back({ a, b, errorToB });
+            else
+                vCollapses.push_back({ b, a, errorToA });
+        }
+        std::sort(vCollapses.begin(), vCollapses.end(), [](const Collapse& l, const Collapse& r)
+            {
+                if (l.error != r.error) return l.error < r.error;
+                return l.from != r.from ? l.from < r.from : l.to < r.to;
+            });
+
+        //every collapse removes about 2 triangles
+        const size_t collapseGoal = std::max<size_t>(1, (vIndices.size() - targetIndexCount) / 6);
+        size_t collapseCount{ 0 };
+        std::fill(vIsLocked.begin(), vIsLocked.end(), false);
+        for (const Collapse& collapse : vCollapses)
+        {
+            if (collapse.error > maxError || collapseCount >= collapseGoal)
+                break;
+            if (vIsLocked[collapse.from] || vIsLocked[collapse.to])
+                continue;
+
+            //reject collapses that flip a triangle around the vertex that moves
+            bool isFlipping{ false };
+            for (uint32_t adjacent{ vAdjacencyOffsets[collapse.from] }; adjacent < vAdjacencyOffsets[collapse.from + 1] && !isFlipping; ++adjacent)
+            {
+                const size_t triangle = size_t(vAdjacency[adjacent]) * 3;
+                glm::dvec3 corners[3];
+                glm::dvec3 movedCorners[3];
+                bool hasTo{ false };
+                for (size_t corner{}; corner < 3; ++corner)
+                {
+                    const uint32_t position = vPositionId[vIndices[triangle + corner]];
+                    hasTo |= position == collapse.to;
+                    corners[corner] = vPositions[position];
+                    movedCorners[corner] = position == collapse.from ? vPositions[collapse.to] : corners[corner];
+                }
+                if (hasTo)
+                    continue; //this one becomes degenerate and gets removed
+
+                const glm::dvec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                const glm::dvec3 movedNormal = glm::cross(movedCorners[1] - movedCorners[0], movedCorners[2] - movedCorners[0]);
+                isFlipping = glm::dot(normal, movedNormal) <= 0.25 * glm::length(normal) * glm::length(movedNormal);
+            }
+            if (isFlipping)
+                continue;
+
+            //the triangles around the moved vertex change, so nothing they touch may collapse in this pass anymore
+            for (uint32_t adjacent{ vAdjacencyOffsets[collapse.from] }; adjacent < vAdjacencyOffsets[collapse.from + 1]; ++adjacent)
+            {
+                const size_t triangle = size_t(vAdjacency[adjacent]) * 3;
+                for (size_t corner{}; corner < 3; ++corner)
+                    vIsLocked[vPositionId[vIndices[triangle + corner]]] = true;
+            }
+
+            vCollapseTo[collapse.from] = collapse.to;
+            vQuadrics[collapse.to].Add(vQuadrics[collapse.from]);
+            resultError = std::max(resultError, float(std::sqrt(collapse.error)));
+            ++collapseCount;
+        }
+
+        if (collapseCount == 0)
+            break;
+
+        //move the collapsed corners and drop the triangles that became degenerate
+        size_t writeIndex{ 0 };
+        for (size_t i{}; i < vIndices.size(); i += 3)
+        {
+            uint32_t triangle[3];
+            for (size_t corner{}; corner < 3; ++corner)
+            {
+                const uint32_t vertex = vIndices[i + corner];
+                const uint32_t position = vPositionId[vertex];
+                triangle[corner] = vCollapseTo[position] == position ? vertex : findClosestWedge(vertices, vWedgeNext, vertex, vCollapseTo[position]);
+            }
+
+            const uint32_t p0 = vPositionId[triangle[0]], p1 = vPositionId[triangle[1]], p2 = vPositionId[triangle[2]];
+            if (p0 == p1 || p1 == p2 || p0 == p2)
+                continue;
+
+            vIndices[writeIndex++] = triangle[0];
+            vIndices[writeIndex++] = triangle[1];
+            vIndices[writeIndex++] = triangle[2];
+        }
+        vIndices.resize(writeIndex);
+
+        for (size_t position{}; position < vertexCount; ++position)
+            vCollapseTo[position] = static_cast<uint32_t>(position);
+    }
+
+    return vIndices;
+}
+
+std::vector<MeshLod> MeshSimplifier::BuildLodChain(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, uint32_t lodCount)
+{
+    std::vector<MeshLod> vLods{ MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.f, 0 } };
+    const float extent = GetExtent(vertices);
+    const float maxError{ 0.05f }; //5% off the model size, beyond that the silhouette breaks down
+
+    std::vector<uint32_t> vCurrent = indices;
+    float totalError{ 0.f };
+    for (uint32_t lod{ 1 }; lod < lodCount; ++lod)
+    {
+        const size_t targetIndexCount = vCurrent.size() / 6 * 3;
+        float error{};
+        std::vector<uint32_t> vNext = Simplify(vCurrent, vertices, targetIndexCount, maxError, error);
+
+        //not worth another level when the simplifier got stuck
+        if (vNext.empty() || vNext.size() * 10 > vCurrent.size() * 9)
+            break;
+
+        //every level is simplified from the previous one, so the errors add up
+        totalError += error * extent;
+        vLods.push_back(MeshLod{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(vNext.size()), totalError, 0 });
+        indices.insert(indices.end(), vNext.begin(), vNext.end());
+        vCurrent.swap(vNext);
+    }
+    return vLods;
+}
+
+std::vector<MeshLod> MeshSimplifier::BuildLodChain(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, uint32_t lodCount,
+    std::vector<Submesh>& submeshes)
+{
+    if (submeshes.size() < 2)
+    {
+        std::vector<MeshLod> vLods = BuildLodChain(indices, vertices, lodCount);
+        const Submesh base = submeshes.empty() ? Submesh{ 0, 0, -1, 0 } : submeshes[0];
+        submeshes.clear();
+        for (const MeshLod& lod : vLods)
+            submeshes.push_back(Submesh{ lod.firstIndex, lod.indexCount, base.materialId, base.shapeId });
+        return vLods;
+    }
+
+    //every submesh gets compacted into its own small vertex array first, Simplify works on the whole vertex count
+    //and all collapses land on existing vertices so the result maps straight back
+    std::vector<std::vector<uint32_t>> vChains(submeshes.size()); //lod indices back to back, local vertex ids
+    std::vector<std::vector<MeshLod>> vChainLods(submeshes.size());
+    std::vector<std::vector<uint32_t>> vLocalToGlobal(submeshes.size());
+    std::vector<uint32_t> vGlobalToLocal(vertices.size(), UINT32_MAX);
+    size_t levelCount{ 1 };
+    for (size_t submesh{}; submesh < submeshes.size(); ++submesh)
+    {
+        const Submesh& range = submeshes[submesh];
+        std::vector<uint32_t>& vLocalIndices = vChains[submesh];
+        std::vector<uint32_t>& vGlobal = vLocalToGlobal[submesh];
+        std::vector<Vertex3D> vLocalVertices;
+
+        vLocalIndices.reserve(range.indexCount);
+        for (uint32_t corner{ range.firstIndex }; corner < range.firstIndex + range.indexCount; ++corner)
+        {
+            const uint32_t vertex = indices[corner];
+            if (vGlobalToLocal[vertex] == UINT32_MAX)
+            {
+                vGlobalToLocal[vertex] = static_cast<uint32_t>(vGlobal.size());
+                vGlobal.push_back(vertex);
+                vLocalVertices.push_back(vertices[vertex]);
+            }
+            vLocalIndices.push_back(vGlobalToLocal[vertex]);
+        }
+        for (uint32_t vertex : vGlobal)
+            vGlobalToLocal[vertex] = UINT32_MAX;
+
+        vChainLods[submesh] = BuildLodChain(vLocalIndices, vLocalVertices, lodCount);
+        levelCount = std::max(levelCount, vChainLods[submesh].size());
+    }
+
+    //lod after lod, each one with all submeshes in the original (material sorted) order
+    std::vector<uint32_t> vIndices;
+    std::vector<Submesh> vSubmeshes;
+    std::vector<MeshLod> vLods;
+    vSubmeshes.reserve(levelCount * submeshes.size());
+    for (size_t level{}; level < levelCount; ++level)
+    {
+        MeshLod lod{ static_cast<uint32_t>(vIndices.size()), 0, 0.f, 0 };
+        for (size_t submesh{}; submesh < submeshes.size(); ++submesh)
+        {
+            const std::vector<MeshLod>& vChainLod = vChainLods[submesh];
+            const MeshLod& chainLod = vChainLod[std::min(level, vChainLod.size() - 1)];
+
+            vSubmeshes.push_back(Submesh{ static_cast<uint32_t>(vIndices.size()), chainLod.indexCount, submeshes[submesh].materialId, submeshes[submesh].shapeId });
+            for (uint32_t corner{ chainLod.firstIndex }; corner < chainLod.firstIndex + chainLod.indexCount; ++corner)
+                vIndices.push_back(vLocalToGlobal[submesh][vChains[submesh][corner]]);
+            lod.error = std::max(lod.error, chainLod.error);
+        }
+        lod.indexCount = static_cast<uint32_t>(vIndices.size()) - lod.firstIndex;
+        vLods.push_back(lod);
+    }
+
+    indices.swap(vIndices);
+    submeshes.swap(vSubmeshes);
+    return vLods;
+}
+
+float MeshSimplifier::GetExtent(const std::vector<Vertex3D>& vertices)
+{
+    if (vertices.empty())
+        return 0.f;
+
+    glm::vec3 minimum{ vertices[0].pos };
+    glm::vec3 maximum{ vertices[0].pos };
+    for (const Vertex3D& vertex : vertices)
+    {
+        minimum = glm::min(minimum, vertex.pos);
+        maximum = glm::max(maximum, vertex.pos);
+    }
+    const glm::vec3 size = maximum - minimum;
+    return std::max(size.x, std::max(size.y, size.z));
+}
@@ -0,0 +1,30 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+//Quadric error metric simplifier (Garland & Heckbert) that only collapses edges onto existing vertices,
+//so every level off detail is just another index range into the same vertex buffer
+class MeshSimplifier
+{
+public:
+    //Collapses edges until about targetIndexCount indices are left or the next collapse would move
+    //the surface more than targetError (relative to the mesh extent)
+    //resultError receives the largest error that was accepted (relative to the mesh extent)
+    static std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices,
+        size_t targetIndexCount, float targetError, float& resultError);
+
+    //Appends up to lodCount - 1 levels (each about half off the previous one) after the full triangle list in indices
+    //returns the ranges, lod 0 is the original mesh
+    static std::vector<MeshLod> BuildLodChain(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, uint32_t lodCount);
+    //Same, but every submesh gets simplified on its own so no triangle changes material. submeshes holds the lod 0 ranges
+    //(back to back from index 0) and receives lodCount * submeshCount ranges, submesh s off lod l at l * submeshCount + s.
+    //A submesh that can not be simplified any further repeats its last level so every lod stays one contiguous range
+    static std::vector<MeshLod> BuildLodChain(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, uint32_t lodCount,
+        std::vector<Submesh>& submeshes);
+
+    //largest size off the bounding box, what the relative errors are measured against
+    static float GetExtent(const std::vector<Vertex3D>& vertices);
+};
@@ -0,0 +1,72 @@
+#include "MipBuilder.h"
+#include "ParallelChunks.h"
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize2.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <stdexcept>
+
+
+uint32_t MipBuilder::CalculateMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t mipCount{ 1 };
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        ++mipCount;
+    return mipCount;
+}
+
+void MipBuilder::Build(const uint8_t* pPixels, uint32_t width, uint32_t height, bool isSrgb,
+    std::vector<TextureCacheMip>& mips, std::vector<uint8_t>& pixels, unsigned int numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    const uint32_t mipCount = CalculateMipCount(width, height);
+    mips.resize(mipCount);
+
+    uint64_t offset{ 0 };
+    for (uint32_t mip{}; mip < mipCount; ++mip)
+    {
+        TextureCacheMip& level = mips[mip];
+        level.width  = std::max(width >> mip, 1u);
+        level.height = std::max(height >> mip, 1u);
+        level.offset = offset;
+        level.size   = uint64_t(level.width) * level.height * 4;
+        offset = (offset + level.size + 15) / 16 * 16;
+    }
+
+    pixels.resize(static_cast<size_t>(offset));
+    memcpy(pixels.data(), pPixels, static_cast<size_t>(mips[0].size));
+
+    //the levels depend on each other, so the threads share the rows off one level at a time
+    //small levels come back with fewer splits (down to 1) and just run on this thread
+    for (uint32_t mip{ 1 }; mip < mipCount; ++mip)
+    {
+        const TextureCacheMip& src = mips[mip - 1];
+        const TextureCacheMip& dst = mips[mip];
+
+        STBIR_RESIZE resize;
+        stbir_resize_init(&resize,
+            pixels.data() + src.offset, static_cast<int>(src.width), static_cast<int>(src.height), 0,
+            pixels.data() + dst.offset, static_cast<int>(dst.width), static_cast<int>(dst.height), 0,
+            STBIR_RGBA, isSrgb ? STBIR_TYPE_UINT8_SRGB : STBIR_TYPE_UINT8);
+        stbir_set_edgemodes(&resize, STBIR_EDGE_CLAMP, STBIR_EDGE_CLAMP);
+
+        const int splits = stbir_build_samplers_with_splits(&resize, static_cast<int>(numThreads));
+        if (splits == 0)
+            throw std::runtime_error("failed to build mip samplers");
+
+        //one split per chunk, the first one on this thread
+        std::vector<int> vIsResized(splits, 0);
+        ParallelChunks::Run(splits, static_cast<unsigned int>(splits), [&](size_t begin, size_t end, unsigned int chunk)
+            {
+                if (begin < end)
+                    vIsResized[chunk] = stbir_resize_extended_split(&resize, static_cast<int>(begin), static_cast<int>(end - begin));
+            });
+        stbir_free_samplers(&resize);
+
+        if (std::find(vIsResized.begin(), vIsResized.end(), 0) != vIsResized.end())
+            throw std::runtime_error("failed to resize mip level");
+    }
+}
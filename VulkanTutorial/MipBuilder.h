@@ -0,0 +1,20 @@
+#pragma once
+#include "TextureCache.h"
+#include <vector>
+#include <cstdint>
+
+//Full mip chains on the cpu with stb_image_resize2 (sse2/avx paths), no vulkan involved so it runs headless
+//and works for formats the gpu can not blit with linear filtering. Every level gets filtered off the one above it,
+//the rows off a level are split across threads
+class MipBuilder
+{
+public:
+    //down to 1x1, same count the blits would make
+    static uint32_t CalculateMipCount(uint32_t width, uint32_t height);
+
+    //tightly packed rgba8 in, every level lands in pixels at mips[level].offset (16 byte aligned, rows tightly packed)
+    //isSrgb filters the color in linear space and encodes it back, alpha is always linear
+    //numThreads = 0 uses all hardware threads
+    static void Build(const uint8_t* pPixels, uint32_t width, uint32_t height, bool isSrgb,
+        std::vector<TextureCacheMip>& mips, std::vector<uint8_t>& pixels, unsigned int numThreads = 0);
+};
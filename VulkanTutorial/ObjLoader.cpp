@@ -0,0 +1,359 @@
+//tinyobj_opt still uses the std::allocator members that got removed in c++20
+//these have to be defined before the first std header gets included
+#define _HAS_DEPRECATED_ALLOCATOR_MEMBERS 1
+#define _SILENCE_CXX17_OLD_ALLOCATOR_MEMBERS_DEPRECATION_WARNING
+#define NOMINMAX //tinyobj_opt includes windows.h
+
+#include "ObjLoader.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#define TINYOBJ_LOADER_OPT_IMPLEMENTATION
+#include <tinyobj_loader_opt.h> //experimental multithreaded obj parser
+
+
+bool ObjLoader::LoadParallel(const std::string& path, int numThreads,
+    tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, std::string& errorMessage)
+{
+    std::vector<char> vBuffer;
+    if (!readFile(path, vBuffer))
+    {
+        errorMessage = "failed to open " + path;
+        return false;
+    }
+
+    tinyobj_opt::attrib_t optAttrib;
+    std::vector<tinyobj_opt::shape_t> vOptShapes;
+    std::vector<tinyobj_opt::material_t> vOptMaterials;
+
+    tinyobj_opt::LoadOption option;
+    option.req_num_threads = numThreads;
+    option.triangulate     = false; //tinyobj_opt only makes fans, quads get split below the same way tinyobj::LoadObj does
+    option.verbose         = false;
+
+    if (!tinyobj_opt::parseObj(&optAttrib, &vOptShapes, &vOptMaterials, vBuffer.data(), vBuffer.size(), option))
+    {
+        errorMessage = "tinyobj_opt failed to parse " + path;
+        return false;
+    }
+
+    //tinyobj_opt looks for the mtllib relative to the working directory, when it did not find it the material ids
+    //would all be -1 while tinyobj::LoadObj resolves them next to the obj
+    const char usemtl[]{ "usemtl" };
+    if (vOptMaterials.empty() && std::search(vBuffer.begin(), vBuffer.end(), usemtl, usemtl + sizeof(usemtl) - 1) != vBuffer.end())
+    {
+        errorMessage = "tinyobj_opt could not resolve the materials off " + path;
+        return false;
+    }
+
+    attrib.vertices.assign(optAttrib.vertices.begin(), optAttrib.vertices.end());
+    attrib.normals.assign(optAttrib.normals.begin(), optAttrib.normals.end());
+    attrib.texcoords.assign(optAttrib.texcoords.begin(), optAttrib.texcoords.end());
+
+    //first index off every face, faces are stored flat in optAttrib.indices
+    const size_t numFaces = optAttrib.face_num_verts.size();
+    std::vector<size_t> vFaceOffsets(numFaces + 1, 0);
+    for (size_t face{}; face < numFaces; ++face)
+    {
+        vFaceOffsets[face + 1] = vFaceOffsets[face] + optAttrib.face_num_verts[face];
+    }
+
+    if (vOptShapes.empty())
+    {
+        tinyobj_opt::shape_t wholeFile{};
+        wholeFile.face_offset = 0;
+        wholeFile.length      = static_cast<unsigned int>(numFaces);
+        vOptShapes.push_back(wholeFile);
+    }
+
+    const size_t numVertices = attrib.vertices.size() / 3;
+    auto toIndex = [](const tinyobj_opt::index_t& optIndex)
+        {
+            tinyobj::index_t index{};
+            index.vertex_index   = optIndex.vertex_index;
+            index.normal_index   = optIndex.normal_index;
+            index.texcoord_index = optIndex.texcoord_index;
+            return index;
+        };
+
+    shapes.clear();
+    shapes.reserve(vOptShapes.size());
+    for (const auto& optShape : vOptShapes)
+    {
+        tinyobj::shape_t shape{};
+        shape.name = optShape.name;
+        tinyobj::mesh_t& mesh = shape.mesh;
+
+        const size_t lastFace = std::min<size_t>(optShape.face_offset + optShape.length, numFaces);
+        for (size_t face{ optShape.face_offset }; face < lastFace; ++face)
+        {
+            const int numFaceVerts = optAttrib.face_num_verts[face];
+            const tinyobj_opt::index_t* pFace = &optAttrib.indices[vFaceOffsets[face]];
+            const int materialId = std::max(-1, optAttrib.material_ids[face]);
+
+            if (numFaceVerts < 3)
+                continue; //degenerated face, also skipped by tinyobj::LoadObj
+
+            if (numFaceVerts == 3)
+            {
+                mesh.indices.push_back(toIndex(pFace[0]));
+                mesh.indices.push_back(toIndex(pFace[1]));
+                mesh.indices.push_back(toIndex(pFace[2]));
+            }
+            else if (numFaceVerts == 4)
+            {
+                bool isValid{ true };
+                for (int i{}; i < 4; ++i)
+                {
+                    if (pFace[i].vertex_index < 0 || static_cast<size_t>(pFace[i].vertex_index) >= numVertices)
+                        isValid = false;
+                }
+                if (!isValid)
+                    continue;
+
+                //split over the shortest diagonal
+                auto sqrDistance = [&attrib](int a, int b)
+                    {
+                        const float dx = attrib.vertices[3 * b + 0] - attrib.vertices[3 * a + 0];
+                        const float dy = attrib.vertices[3 * b + 1] - attrib.vertices[3 * a + 1];
+                        const float dz = attrib.vertices[3 * b + 2] - attrib.vertices[3 * a + 2];
+                        return dx * dx + dy * dy + dz * dz;
+                    };
+                const float sqr02 = sqrDistance(pFace[0].vertex_index, pFace[2].vertex_index);
+                const float sqr13 = sqrDistance(pFace[1].vertex_index, pFace[3].vertex_index);
+
+                const int order02[6]{ 0, 1, 2, 0, 2, 3 };
+                const int order13[6]{ 0, 1, 3, 1, 2, 3 };
+                const int* pOrder = sqr02 < sqr13 ? order02 : order13;
+                for (int i{}; i < 6; ++i)
+                {
+                    mesh.indices.push_back(toIndex(pFace[pOrder[i]]));
+                }
+
+                mesh.num_face_vertices.push_back(3);
+                mesh.material_ids.push_back(materialId);
+                mesh.smoothing_group_ids.push_back(0);
+            }
+            else
+            {
+                //tinyobj::LoadObj uses ear clipping for these, not worth duplicating here
+                errorMessage = "parallel obj loader does not support faces with more than 4 vertices";
+                return false;
+            }
+
+            mesh.num_face_vertices.push_back(3);
+            mesh.material_ids.push_back(materialId);
+            mesh.smoothing_group_ids.push_back(0);
+        }
+
+        shapes.push_back(std::move(shape));
+    }
+
+    return true;
+}
+
+//state shared by the LoadObjWithCallback callbacks
+struct StreamState
+{
+    tinyobj::attrib_t* pAttrib;
+    const ObjLoader::CornerCallback* pOnCorner;
+    std::string errorMessage;
+    int materialId{ -1 };
+    uint32_t shapeId{ 0 };
+    bool hasShapeFaces{ false }; //like tinyobj::LoadObj a g/o line only starts a new shape after faces
+};
+
+//same rules as fixIndex inside tinyobj: 1 based, negative is relative to the end, 0 means missing
+static int resolveIndex(int index, size_t count)
+{
+    if (index > 0)
+        return index - 1;
+    if (index < 0)
+        return static_cast<int>(count) + index;
+    return -1;
+}
+
+static void nextShape(StreamState& state)
+{
+    if (!state.hasShapeFaces)
+        return;
+    ++state.shapeId;
+    state.hasShapeFaces = false;
+}
+
+static void onFace(void* pUserData, tinyobj::index_t* pIndices, int numIndices)
+{
+    StreamState& state = *static_cast<StreamState*>(pUserData);
+    if (!state.errorMessage.empty())
+        return; //already failed, just let the parser run out
+
+    const tinyobj::attrib_t& attrib = *state.pAttrib;
+    const size_t numVertices = attrib.vertices.size() / 3;
+    for (int i{}; i < numIndices; ++i)
+    {
+        pIndices[i].vertex_index   = resolveIndex(pIndices[i].vertex_index, numVertices);
+        pIndices[i].normal_index   = resolveIndex(pIndices[i].normal_index, attrib.normals.size() / 3);
+        pIndices[i].texcoord_index = resolveIndex(pIndices[i].texcoord_index, attrib.texcoords.size() / 2);
+        if (pIndices[i].vertex_index < 0)
+        {
+            state.errorMessage = "invalid vertex index in face";
+            return;
+        }
+    }
+
+    if (numIndices < 3)
+        return; //degenerated face, also skipped by tinyobj::LoadObj
+    state.hasShapeFaces = true;
+
+    if (numIndices == 3)
+    {
+        for (int i{}; i < 3; ++i)
+            (*state.pOnCorner)(attrib, pIndices[i], state.materialId, state.shapeId);
+    }
+    else if (numIndices == 4)
+    {
+        for (int i{}; i < 4; ++i)
+        {
+            if (static_cast<size_t>(pIndices[i].vertex_index) >= numVertices)
+                return;
+        }
+
+        //split over the shortest diagonal
+        auto sqrDistance = [&attrib](int a, int b)
+            {
+                const float dx = attrib.vertices[3 * b + 0] - attrib.vertices[3 * a + 0];
+                const float dy = attrib.vertices[3 * b + 1] - attrib.vertices[3 * a + 1];
+                const float dz = attrib.vertices[3 * b + 2] - attrib.vertices[3 * a + 2];
+                return dx * dx + dy * dy + dz * dz;
+            };
+        const float sqr02 = sqrDistance(pIndices[0].vertex_index, pIndices[2].vertex_index);
+        const float sqr13 = sqrDistance(pIndices[1].vertex_index, pIndices[3].vertex_index);
+
+        const int order02[6]{ 0, 1, 2, 0, 2, 3 };
+        const int order13[6]{ 0, 1, 3, 1, 2, 3 };
+        const int* pOrder = sqr02 < sqr13 ? order02 : order13;
+        for (int i{}; i < 6; ++i)
+            (*state.pOnCorner)(attrib, pIndices[pOrder[i]], state.materialId, state.shapeId);
+    }
+    else
+    {
+        //tinyobj::LoadObj uses ear clipping for these, not worth duplicating here
+        state.errorMessage = "streaming obj loader does not support faces with more than 4 vertices";
+    }
+}
+
+bool ObjLoader::LoadStreaming(const std::string& path, tinyobj::attrib_t& attrib, const CornerCallback& onCorner, std::string& errorMessage)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        errorMessage = "failed to open " + path;
+        return false;
+    }
+
+    //a rough guess so the attribute arrays do not have to grow from nothing (~30 bytes per line)
+    std::error_code error;
+    const size_t estimatedLines = static_cast<size_t>(std::filesystem::file_size(path, error) / 30);
+    if (!error)
+        attrib.vertices.reserve(estimatedLines);
+
+    StreamState state{ &attrib, &onCorner, {} };
+    tinyobj::MaterialFileReader materialReader{ GetMaterialBaseDir(path) };
+
+    tinyobj::callback_t callbacks;
+    callbacks.vertex_cb = [](void* pUserData, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t)
+        {
+            std::vector<tinyobj::real_t>& vertices = static_cast<StreamState*>(pUserData)->pAttrib->vertices;
+            vertices.insert(vertices.end(), { x, y, z });
+        };
+    callbacks.normal_cb = [](void* pUserData, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z)
+        {
+            std::vector<tinyobj::real_t>& normals = static_cast<StreamState*>(pUserData)->pAttrib->normals;
+            normals.insert(normals.end(), { x, y, z });
+        };
+    callbacks.texcoord_cb = [](void* pUserData, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t)
+        {
+            std::vector<tinyobj::real_t>& texcoords = static_cast<StreamState*>(pUserData)->pAttrib->texcoords;
+            texcoords.insert(texcoords.end(), { x, y });
+        };
+    callbacks.index_cb = onFace;
+    callbacks.usemtl_cb = [](void* pUserData, const char*, int materialId)
+        {
+            static_cast<StreamState*>(pUserData)->materialId = materialId;
+        };
+    callbacks.group_cb = [](void* pUserData, const char**, int)
+        {
+            nextShape(*static_cast<StreamState*>(pUserData));
+        };
+    callbacks.object_cb = [](void* pUserData, const char*)
+        {
+            nextShape(*static_cast<StreamState*>(pUserData));
+        };
+
+    std::string warningMessage;
+    if (!tinyobj::LoadObjWithCallback(file, callbacks, &state, &materialReader, &warningMessage, &errorMessage))
+        return false;
+
+    if (!state.errorMessage.empty())
+    {
+        errorMessage = state.errorMessage;
+        return false;
+    }
+    return true;
+}
+
+Vertex3D ObjLoader::BuildVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index, bool isColored)
+{
+    Vertex3D vertex{};
+
+    vertex.pos = {
+        attrib.vertices[3 * index.vertex_index + 0],
+        attrib.vertices[3 * index.vertex_index + 1],
+        attrib.vertices[3 * index.vertex_index + 2]
+    };
+    if (isColored && index.texcoord_index >= 0)
+    {
+        vertex.texcoord = {
+            attrib.texcoords[2 * index.texcoord_index + 0],
+           1.0f - attrib.texcoords[2 * index.texcoord_index + 1] //1.0- is because we flip the y-axis in our settings
+        };
+    }
+
+    if (isColored && attrib.normals.size()> 3 * index.vertex_index + 2)
+    {
+        vertex.normal = {
+            attrib.normals[3 * index.vertex_index + 0],
+            attrib.normals[3 * index.vertex_index + 1],
+            attrib.normals[3 * index.vertex_index + 2]
+        };
+    }
+    else
+    {
+        vertex.normal = { 0.0f, 0.0f, 1.f };
+    }
+    return vertex;
+}
+
+std::string ObjLoader::GetMaterialBaseDir(const std::string& path)
+{
+    std::string baseDir = std::filesystem::path(path).parent_path().generic_string();
+    if (!baseDir.empty())
+        baseDir += '/';
+    return baseDir;
+}
+
+bool ObjLoader::readFile(const std::string& path, std::vector<char>& buffer)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    const size_t fileSize{ static_cast<size_t>(file.tellg()) };
+    buffer.resize(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include <tiny_obj_loader.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+//Alternative obj parsers that fill the same attrib/shape layout as tinyobj::LoadObj,
+//so the vertex building in Mesh::loadModel is shared between all load paths
+class ObjLoader
+{
+public:
+    //Multithreaded parse through tinyobj_opt::parseObj (numThreads = -1 uses all hardware threads)
+    //Faces are triangulated the same way tinyobj::LoadObj does it, so the output is identical.
+    //Returns false when the file can not be handled here (caller should fall back to tinyobj::LoadObj)
+    static bool LoadParallel(const std::string& path, int numThreads,
+        tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, std::string& errorMessage);
+
+    //called for every triangle corner in file order, indices are already 0 based (-1 when missing) like tinyobj::LoadObj gives them
+    //materialId/shapeId match the material_ids and shape order tinyobj::LoadObj would give the face
+    using CornerCallback = std::function<void(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index, int materialId, uint32_t shapeId)>;
+
+    //Streams the file through tinyobj::LoadObjWithCallback. Only positions, normals and uvs get stored in attrib
+    //(faces can point at any earlier one), faces are triangulated like tinyobj::LoadObj and handed to onCorner right away
+    //instead off being collected in shapes first. Returns false for files this can not handle (faces with more than 4 vertices)
+    static bool LoadStreaming(const std::string& path, tinyobj::attrib_t& attrib, const CornerCallback& onCorner, std::string& errorMessage);
+
+    //directory the .mtl files off an obj are loaded from (with a trailing '/', empty for the working directory)
+    static std::string GetMaterialBaseDir(const std::string& path);
+
+    //vertex for one face corner, shared by every load path (and the benchmarks) so they build identical vertices
+    //isColored reads the uvs and normals, corners without a uv keep (0, 0)
+    static Vertex3D BuildVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index, bool isColored);
+
+private:
+    static bool readFile(const std::string& path, std::vector<char>& buffer);
+};
@@ -1,277 +1,617 @@
 #include "Object.h"
+#include "ObjLoader.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h> //obj parser
-#include <unordered_map>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <numeric>
+#include <algorithm>
 
 #include "Pipeline.h"
+#include "VertexDedupTable.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Camera.h"
+#include "VertexPacker.h"
+#include "LoaderPool.h"
+#include "MeshRegistry.h"
+#include "LoadLog.h"
+
+
+//material and shape off one triangle while loading
+struct SubmeshKey
+{
+    int32_t materialId;
+    uint32_t shapeId;
 
+    bool operator<(const SubmeshKey& other)const
+    {
+        return materialId != other.materialId ? materialId < other.materialId : shapeId < other.shapeId;
+    }
+    bool operator!=(const SubmeshKey& other)const { return materialId != other.materialId || shapeId != other.shapeId; }
+};
 
-void SceneObject::Init(VkPhysicalDevice& physicalDevice, VkDevice& logicDevice, VkCommandPool& commandPool, const int FrmasInFlight, VkQueue& graphicsQueue)
+//stable sort off the triangles by material then shape, returns one range per key
+static std::vector<Submesh> sortBySubmesh(std::vector<uint32_t>& indices, const std::vector<SubmeshKey>& triangleKeys)
 {
-    loadModel();
-    createVertexBuffer(physicalDevice, logicDevice, commandPool, graphicsQueue);
-    createIndexBuffer(physicalDevice, logicDevice, commandPool, graphicsQueue);
-    //createCommandBuffers(logicDevice, commandPool, FrmasInFlight);
-}
+    std::vector<Submesh> vSubmeshes;
+    if (triangleKeys.empty())
+        return vSubmeshes;
 
-void SceneObject::Record(VkCommandBuffer commandBuffer)
-{
-    VkBuffer vertexBuffers[] = { m_VertexBuffer };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    if (!std::is_sorted(triangleKeys.begin(), triangleKeys.end()))
+    {
+        std::vector<uint32_t> vOrder(triangleKeys.size());
+        std::iota(vOrder.begin(), vOrder.end(), 0u);
+        std::stable_sort(vOrder.begin(), vOrder.end(), [&triangleKeys](uint32_t a, uint32_t b) { return triangleKeys[a] < triangleKeys[b]; });
 
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_vIndices.size()), 1, 0, 0, 0);
+        std::vector<uint32_t> vSorted(indices.size());
+        std::vector<SubmeshKey> vSortedKeys(triangleKeys.size());
+        for (size_t triangle{}; triangle < vOrder.size(); ++triangle)
+        {
+            std::copy_n(indices.begin() + 3 * vOrder[triangle], 3, vSorted.begin() + 3 * triangle);
+            vSortedKeys[triangle] = triangleKeys[vOrder[triangle]];
+        }
+        indices.swap(vSorted);
+        return sortBySubmesh(indices, vSortedKeys);
+    }
+
+    for (uint32_t triangle{}; triangle < triangleKeys.size(); ++triangle)
+    {
+        if (triangle == 0 || triangleKeys[triangle] != triangleKeys[triangle - 1])
+            vSubmeshes.push_back(Submesh{ 3 * triangle, 0, triangleKeys[triangle].materialId, triangleKeys[triangle].shapeId });
+        vSubmeshes.back().indexCount += 3;
+    }
+    return vSubmeshes;
 }
 
 
-void SceneObject::Destroy(VkDevice& logicDevice)
+std::shared_future<void> Mesh::InitAsync(LoaderPool& loaderPool)
 {
-    vkDestroyBuffer(logicDevice, m_IndexBuffer, nullptr);
-    vkFreeMemory(logicDevice, m_IndexBufferMemory, nullptr);
-    vkDestroyBuffer(logicDevice, m_VertexBuffer, nullptr);
-    vkFreeMemory(logicDevice, m_VertexBufferMemory, nullptr);
-   
+    m_State = ResidencyState::Loading;
+    m_LoadStartTime = std::chrono::high_resolution_clock::now();
+    //the pool already runs the meshes side by side, so every model load in flight gets an equal share off the hardware
+    //instead off each one starting a full set off threads
+    const bool isModel = !m_ModelPath.empty();
+    if (isModel)
+        ++s_LoadsInFlight;
+    m_LoadFuture = loaderPool.Submit([this, isModel]()
+        {
+            const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency() / std::max(1u, s_LoadsInFlight.load()));
+            try {
+                loadModel(numThreads);
+            }
+            catch (...) {
+                if (isModel)
+                    --s_LoadsInFlight;
+                throw;
+            }
+            if (isModel)
+                --s_LoadsInFlight;
+        }).share();
+    return m_LoadFuture;
 }
 
+bool Mesh::UpdateResidency(DeviceAllocator& allocator, MeshArena& arena, const std::shared_ptr<UploadBatch>& pUploadBatch)
+{
+    if (m_State == ResidencyState::Loading && m_LoadFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        m_LoadFuture.get(); //rethrows whatever loadModel threw on the worker
+        beginUpload(allocator, arena, pUploadBatch);
+    }
 
+    if (m_State == ResidencyState::Uploading && m_pUploadBatch->IsComplete())
+    {
+        finishUpload();
+        if (LoadLog::IsVerbose() && m_LoadStartTime != std::chrono::high_resolution_clock::time_point{})
+        {
+            auto loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_LoadStartTime).count();
+            std::cout << (m_ModelPath.empty() ? "2D object" : m_ModelPath) << " resident after " << loadTime << " ms\n";
+        }
+    }
 
+    return m_State == ResidencyState::Resident;
+}
 
-void SceneObject::loadModel()
+void Mesh::Record(VkCommandBuffer commandBuffer, const MaterialBinder& bindMaterial, MeshBindState* pBindState)
 {
-    if (m_ModelPath == "")return;
+    drawLod(commandBuffer, 0, bindMaterial, pBindState);
+}
 
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warningMessage, errorMessege;
+void Mesh::Record(VkCommandBuffer commandBuffer, const glm::mat4& world, const Camera& camera, float viewportHeight, const MaterialBinder& bindMaterial,
+    MeshBindState* pBindState)
+{
+    drawLod(commandBuffer, selectLod(world, camera, viewportHeight), bindMaterial, pBindState);
+}
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warningMessage, &errorMessege, m_ModelPath.c_str()))
+void Mesh::drawLod(VkCommandBuffer commandBuffer, uint32_t lod, const MaterialBinder& bindMaterial, MeshBindState* pBindState)
+{
+    //the buffers are always bound at 0, the arena range goes into firstIndex and vertexOffset instead
+    //so every mesh in the same arena buffer keeps the same bindings
+    MeshBindState bindState{};
+    if (!pBindState)
+        pBindState = &bindState;
+    if (pBindState->vertexBuffer != m_VertexBuffer)
     {
-        throw std::runtime_error{ "failed to load in obj" + warningMessage + errorMessege };
+        VkBuffer vertexBuffers[] = { m_VertexBuffer };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        pBindState->vertexBuffer = m_VertexBuffer;
     }
-
-    std::unordered_map<Vertex3D, uint32_t> mUniqueVertexes{};
-    for (const auto& shape : shapes)
+    if (pBindState->indexBuffer != m_IndexBuffer || pBindState->indexType != m_IndexType)
     {
-        for (const auto& index : shape.mesh.indices)
-        {
-            Vertex3D vertex{};
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-            if (m_IsCollored)
-            {
-                vertex.texcoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                   1.0f - attrib.texcoords[2 * index.texcoord_index + 1] //1.0- is because we flip the y-axis in our settings
-                };
-            }
+        vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer, 0, m_IndexType);
+        pBindState->indexBuffer = m_IndexBuffer;
+        pBindState->indexType   = m_IndexType;
+    }
 
-            if (m_IsCollored && attrib.normals.size()> 3 * index.vertex_index + 2)
-            {
-                vertex.normal = {
-                    attrib.normals[3 * index.vertex_index + 0],
-                    attrib.normals[3 * index.vertex_index + 1],
-                    attrib.normals[3 * index.vertex_index + 2]
-                };
-            }
-            else
-            {
-                vertex.normal = { 0.0f, 0.0f, 1.f };
-            }
-            if (mUniqueVertexes.count(vertex) == 0)
-            {
-                mUniqueVertexes[vertex] = static_cast<uint32_t>(m_vVertices3D.size());
-                m_vVertices3D.push_back(vertex);
-            }
+    const uint32_t baseIndex = static_cast<uint32_t>(m_IndexOffset / (m_IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+    const int32_t baseVertex = static_cast<int32_t>(m_VertexOffset / MeshArena::GetVertexStride(m_VertexFormat));
 
-            m_vIndices.push_back(mUniqueVertexes[vertex]);
-        }
+    if (!bindMaterial)
+    {
+        vkCmdDrawIndexed(commandBuffer, m_vLods[lod].indexCount, 1, baseIndex + m_vLods[lod].firstIndex, baseVertex, 0);
+        return;
     }
-}
 
-//void SceneObject::createCommandBuffers(VkDevice& logicDevice, VkCommandPool& commandPool, const int FrmasInFlight)
-//{
-//    m_vCommandBuffers.resize(FrmasInFlight);
-//
-//    VkCommandBufferAllocateInfo allocInfo{};
-//    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-//    allocInfo.commandPool        = commandPool;
-//    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-//    allocInfo.commandBufferCount = static_cast<uint32_t>(m_vCommandBuffers.size());
-//
-//    if (vkAllocateCommandBuffers(logicDevice, &allocInfo, m_vCommandBuffers.data()) != VK_SUCCESS)
-//    {
-//        throw std::runtime_error("Allocation off command buffer failed");
-//    }
-//
-//}
+    //the ranges are sorted by material and back to back, so every material is bound once and drawn in one call
+    const Submesh* pSubmeshes = GetSubmeshes(lod);
+    const uint32_t submeshCount = GetSubmeshCount();
+    for (uint32_t submesh{}; submesh < submeshCount;)
+    {
+        const int32_t materialId = pSubmeshes[submesh].materialId;
+        const uint32_t firstIndex = pSubmeshes[submesh].firstIndex;
+        uint32_t indexCount{ 0 };
+        for (; submesh < submeshCount && pSubmeshes[submesh].materialId == materialId; ++submesh)
+            indexCount += pSubmeshes[submesh].indexCount;
+
+        bindMaterial(commandBuffer, materialId);
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, baseIndex + firstIndex, baseVertex, 0);
+    }
+}
 
-void SceneObject::createVertexBuffer(VkPhysicalDevice& physicalDevice, VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue)
+uint32_t Mesh::selectLod(const glm::mat4& world, const Camera& camera, float viewportHeight)const
 {
-    VkDeviceSize bufferSize = m_Is3D ? sizeof(m_vVertices3D[0]) * m_vVertices3D.size() : sizeof(m_vVertices2D[0]) * m_vVertices2D.size();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    if (m_vLods.size() < 2 || m_BoundsRadius <= 0.f)
+        return 0;
+
+    //bounding sphere in world space, the radius scales with the largest axis off the transform
+    const glm::vec3 center = glm::vec3(world * glm::vec4(m_BoundsCenter, 1.f));
+    const float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+    const float radius = m_BoundsRadius * scale;
+    const float distance = glm::length(center - camera.GetPosition());
+    if (distance <= radius)
+        return 0; //camera is inside the sphere
+
+    //radius off the sphere in pixels on the screen, the lod errors are in model units so they scale the same way
+    const float projectedRadius = radius / (distance * std::tan(std::abs(camera.GetfieldOfView()) * 0.5f)) * viewportHeight * 0.5f;
+    const float pixelsPerUnit = projectedRadius / m_BoundsRadius;
+
+    uint32_t lod{ 0 };
+    while (lod + 1 < m_vLods.size() && m_vLods[lod + 1].error * pixelsPerUnit <= m_LodPixelError)
+        ++lod;
+    return lod;
+}
 
-    createBuffer(physicalDevice, logicDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer, stagingBufferMemory);
 
-    void* data;
-    void* srcData{ m_Is3D ? (void*)m_vVertices3D.data() : (void*)m_vVertices2D.data() };
-    vkMapMemory(logicDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, srcData, static_cast<size_t>(bufferSize));
-    vkUnmapMemory(logicDevice, stagingBufferMemory);
+void Mesh::Destroy()
+{
+    //a worker can still be writing into this object, and an upload can still be reading its staging buffers
+    if (m_LoadFuture.valid())
+        m_LoadFuture.wait();
+    if (m_State == ResidencyState::Uploading)
+    {
+        m_pUploadBatch->Wait();
+        finishUpload();
+    }
 
-    //Binding the vertex buffer will happen in the recordCommandBuffer()
+    if (m_IsIndexInArena)
+        m_pArena->FreeIndices(m_VertexFormat, m_IndexBuffer, m_IndexOffset, m_IndexBytes);
+    else if (m_pAllocator)
+        m_pAllocator->DestroyBuffer(m_IndexBuffer, m_IndexAllocation);
+    if (m_IsVertexInArena)
+        m_pArena->FreeVertices(m_VertexFormat, m_VertexBuffer, m_VertexOffset, m_VertexBytes);
+    else if (m_pAllocator)
+        m_pAllocator->DestroyBuffer(m_VertexBuffer, m_VertexAllocation);
+    m_IsIndexInArena = m_IsVertexInArena = false;
+    m_IndexBuffer = m_VertexBuffer = VK_NULL_HANDLE;
+    m_State = ResidencyState::Unloaded;
+}
 
-    createBuffer(physicalDevice, logicDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        m_VertexBuffer, m_VertexBufferMemory);
 
-    copyBuffer(logicDevice, commandPool, graphicsQueue, stagingBuffer, m_VertexBuffer, bufferSize);
+SceneObject::SceneObject(MeshRegistry& registry, const std::string& modelPath, const std::string& texturePath, bool isColored, ObjLoadMode loadMode,
+    bool optimizeMesh, uint32_t lodCount, VertexFormat vertexFormat)
+    : m_pMesh{ registry.Acquire(modelPath, isColored, loadMode, optimizeMesh, lodCount, vertexFormat) }, m_pRegistry{ &registry }, m_TexturePath{ texturePath }
+{
+}
 
-    //Clean up temp buffer/ bufferMemory
-    vkDestroyBuffer(logicDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicDevice, stagingBufferMemory, nullptr);
+void SceneObject::InitAsync(LoaderPool& loaderPool)
+{
+    if (m_pMesh->GetState() == ResidencyState::Unloaded)
+        m_pMesh->InitAsync(loaderPool);
+}
 
+bool SceneObject::UpdateResidency(DeviceAllocator& allocator, MeshArena& arena, const std::shared_ptr<UploadBatch>& pUploadBatch)
+{
+    return m_pMesh->UpdateResidency(allocator, arena, pUploadBatch);
 }
 
-void SceneObject::createIndexBuffer(VkPhysicalDevice& physicalDevice, VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue)
+void SceneObject::Destroy()
 {
-    VkDeviceSize bufferSize = sizeof(m_vIndices[0]) * m_vIndices.size();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory staginBufferMemory;
-    createBuffer(physicalDevice, logicDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        stagingBuffer, staginBufferMemory);
-
-    void* data;
-    vkMapMemory(logicDevice, staginBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_vIndices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(logicDevice, staginBufferMemory);
-
-    createBuffer(physicalDevice, logicDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        m_IndexBuffer, m_IndexBufferMemory);
-
-    copyBuffer(logicDevice, commandPool, graphicsQueue ,stagingBuffer, m_IndexBuffer, bufferSize);
-
-    vkDestroyBuffer(logicDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicDevice, staginBufferMemory, nullptr);
+    if (!m_pMesh)
+        return;
+
+    if (m_pRegistry)
+        m_pRegistry->Release(m_pMesh);
+    else
+        m_pMesh->Destroy();
+    m_pMesh.reset();
 }
 
 
+void Mesh::loadModel(unsigned int numThreads)
+{
+    if (m_ModelPath == "")return;
+
+    //warm start: the buffers get filled straight from the mapped cache file
+    m_pMeshCache = std::make_unique<MeshCache>();
+    if (m_pMeshCache->Open(m_ModelPath, GetImportFlags()))
+    {
+        m_vLods.assign(m_pMeshCache->GetLods(), m_pMeshCache->GetLods() + m_pMeshCache->GetLodCount());
+        m_vSubmeshes.assign(m_pMeshCache->GetSubmeshes(), m_pMeshCache->GetSubmeshes() + m_pMeshCache->GetLodCount() * m_pMeshCache->GetSubmeshCount());
+        calculateBounds(m_pMeshCache->GetVertices(), m_pMeshCache->GetVertexCount());
+        if (LoadLog::IsVerbose())
+            std::cout << m_ModelPath << " [cache] (" << m_pMeshCache->GetVertexCount() << " vertices, " << m_pMeshCache->GetIndexCount() << " indices)\n";
+        return;
+    }
+    m_pMeshCache.reset();
 
+    bool isStreamed{ false };
+    if (m_LoadMode == ObjLoadMode::Streaming)
+        isStreamed = loadStreaming();
+    if (!isStreamed)
+        loadBuffered(numThreads);
 
+    if (m_LodCount > 1)
+    {
+        auto lodStartTime = std::chrono::high_resolution_clock::now();
+        m_vLods = MeshSimplifier::BuildLodChain(m_vIndices, m_vVertices3D, m_LodCount, m_vSubmeshes);
+        auto lodEndTime = std::chrono::high_resolution_clock::now();
 
+        if (LoadLog::IsVerbose())
+        {
+            std::cout << m_ModelPath << " lods: " << std::chrono::duration<float, std::milli>(lodEndTime - lodStartTime).count() << "ms";
+            for (const MeshLod& lod : m_vLods)
+                std::cout << " [" << lod.indexCount / 3 << " triangles, error " << lod.error << "]";
+            std::cout << "\n";
+        }
+    }
+    else
+    {
+        m_vLods = { MeshLod{ 0, static_cast<uint32_t>(m_vIndices.size()), 0.f, 0 } };
+    }
 
+    if (m_IsOptimized)
+        optimizeMesh();
 
-VkCommandBuffer SceneObject::BeginSingleCommand(VkDevice& logicDevice, VkCommandPool& commandPool)
-{
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool        = commandPool;
-    allocInfo.commandBufferCount = 1;
+    calculateBounds(m_vVertices3D.data(), m_vVertices3D.size());
 
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(logicDevice, &allocInfo, &commandBuffer);
+    if (!MeshCache::Write(m_ModelPath, GetImportFlags(), m_vVertices3D, m_vIndices, m_vLods, m_vSubmeshes))
+        std::cout << "failed to write mesh cache for " << m_ModelPath << "\n";
+}
 
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+bool Mesh::loadStreaming()
+{
+    //only the raw obj attributes and the output mesh are alive while parsing, no shapes/corner arrays
+    auto startTime = std::chrono::high_resolution_clock::now();
+    tinyobj::attrib_t attrib;
+    VertexDedupTable uniqueVertices{ 1024 }; //grows with the mesh, the face count is not known up front
+    std::vector<SubmeshKey> vTriangleKeys;
+    std::string errorMessege;
 
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    const bool isLoaded = ObjLoader::LoadStreaming(m_ModelPath, attrib,
+        [this, &uniqueVertices, &vTriangleKeys](const tinyobj::attrib_t& streamedAttrib, const tinyobj::index_t& index, int materialId, uint32_t shapeId)
+        {
+            if (m_vIndices.size() % 3 == 0)
+                vTriangleKeys.push_back(SubmeshKey{ materialId, shapeId });
+            m_vIndices.push_back(uniqueVertices.Insert(ObjLoader::BuildVertex(streamedAttrib, index, m_IsCollored), m_vVertices3D));
+        }, errorMessege);
 
-    return commandBuffer;
+    if (!isLoaded)
+    {
+        std::cout << "streaming load off " << m_ModelPath << " failed, using tinyobj::LoadObj: " << errorMessege << "\n";
+        std::vector<Vertex3D>().swap(m_vVertices3D);
+        std::vector<uint32_t>().swap(m_vIndices);
+        return false;
+    }
+    m_vSubmeshes = sortBySubmesh(m_vIndices, vTriangleKeys);
+
+    if (LoadLog::IsVerbose())
+    {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        const size_t attribBytes = (attrib.vertices.capacity() + attrib.normals.capacity() + attrib.texcoords.capacity()) * sizeof(tinyobj::real_t);
+        std::cout << m_ModelPath << " [streaming] parse + build: " << std::chrono::duration<float, std::milli>(endTime - startTime).count() << "ms"
+            << " (" << m_vVertices3D.size() << " vertices, " << m_vIndices.size() << " indices, " << m_vSubmeshes.size() << " submeshes, "
+            << attribBytes / 1024 << "KB obj attributes)\n";
+    }
+    return true;
 }
 
-void SceneObject::EndSingleCommand(VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue, VkCommandBuffer& commandBuffer)
+void Mesh::loadBuffered(unsigned int numThreads)
 {
-    vkEndCommandBuffer(commandBuffer);
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warningMessage, errorMessege;
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffer;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    bool isLoaded{ false };
+    if (m_LoadMode == ObjLoadMode::Parallel)
+    {
+        isLoaded = ObjLoader::LoadParallel(m_ModelPath, static_cast<int>(numThreads), attrib, shapes, errorMessege);
+        if (!isLoaded)
+        {
+            std::cout << "parallel load off " << m_ModelPath << " failed, using tinyobj::LoadObj: " << errorMessege << "\n";
+            errorMessege.clear();
+        }
+    }
 
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    const std::string materialBaseDir = ObjLoader::GetMaterialBaseDir(m_ModelPath);
+    if (!isLoaded && !tinyobj::LoadObj(&attrib, &shapes, &materials, &warningMessage, &errorMessege, m_ModelPath.c_str(), materialBaseDir.c_str()))
+    {
+        throw std::runtime_error{ "failed to load in obj" + warningMessage + errorMessege };
+    }
+    auto parseTime = std::chrono::high_resolution_clock::now();
 
-    vkFreeCommandBuffers(logicDevice, commandPool, 1, &commandBuffer);
+    size_t totalIndices{ 0 };
+    for (const auto& shape : shapes)
+        totalIndices += shape.mesh.indices.size();
+    m_vIndices.reserve(totalIndices);
 
+    //tinyobj already triangulated, so there is one material id per triangle
+    std::vector<SubmeshKey> vTriangleKeys;
+    vTriangleKeys.reserve(totalIndices / 3);
+    for (uint32_t shape{}; shape < shapes.size(); ++shape)
+    {
+        const std::vector<int>& vMaterialIds = shapes[shape].mesh.material_ids;
+        for (size_t triangle{}; triangle < shapes[shape].mesh.indices.size() / 3; ++triangle)
+            vTriangleKeys.push_back(SubmeshKey{ triangle < vMaterialIds.size() ? vMaterialIds[triangle] : -1, shape });
+    }
+
+    //the sharded dedup gives the exact same output, it only pays off once there are enough corners to split
+    const bool isParallelDedup = m_LoadMode == ObjLoadMode::Parallel && numThreads > 1 && totalIndices >= m_ParallelDedupMinCorners;
+    if (isParallelDedup)
+    {
+        std::vector<Vertex3D> vCorners;
+        vCorners.reserve(totalIndices);
+        for (const auto& shape : shapes)
+            for (const auto& index : shape.mesh.indices)
+                vCorners.push_back(ObjLoader::BuildVertex(attrib, index, m_IsCollored));
+
+        VertexDedupTable::DeduplicateParallel(vCorners, numThreads, m_vVertices3D, m_vIndices);
+    }
+    else
+    {
+        VertexDedupTable uniqueVertices{ totalIndices };
+        for (const auto& shape : shapes)
+            for (const auto& index : shape.mesh.indices)
+                m_vIndices.push_back(uniqueVertices.Insert(ObjLoader::BuildVertex(attrib, index, m_IsCollored), m_vVertices3D));
+    }
+
+    m_vSubmeshes = sortBySubmesh(m_vIndices, vTriangleKeys);
+
+    if (LoadLog::IsVerbose())
+    {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        std::cout << m_ModelPath << (isLoaded ? " [parallel]" : " [serial]")
+            << " parse: " << std::chrono::duration<float, std::milli>(parseTime - startTime).count() << "ms"
+            << (isParallelDedup ? " parallel build: " : " build: ") << std::chrono::duration<float, std::milli>(endTime - parseTime).count() << "ms"
+            << " (" << m_vVertices3D.size() << " vertices, " << m_vIndices.size() << " indices, " << m_vSubmeshes.size() << " submeshes)\n";
+    }
 }
 
-void SceneObject::copyBuffer(VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue, VkBuffer& srcBuffer, VkBuffer& dstBuffer, VkDeviceSize& size)
+void Mesh::optimizeMesh()
 {
-    VkCommandBuffer commandBuffer = BeginSingleCommand(logicDevice, commandPool);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto lodIndices = [this](const MeshLod& lod) { return std::vector<uint32_t>(m_vIndices.begin() + lod.firstIndex, m_vIndices.begin() + lod.firstIndex + lod.indexCount); };
+    //the cache stats are only for the log, the passes do not need them
+    const bool isLogged = LoadLog::IsVerbose();
+    const VertexCacheStats before = isLogged ? MeshOptimizer::AnalyzeVertexCache(lodIndices(m_vLods[0]), m_vVertices3D.size()) : VertexCacheStats{};
+
+    //every submesh off every lod gets its own triangle order (they have to stay in their range for the materials),
+    //the vertex order is shared so it is done over all off them at once
+    size_t clusterCount{ 0 };
+    for (const Submesh& submesh : m_vSubmeshes)
+    {
+        const MeshLod lod{ submesh.firstIndex, submesh.indexCount, 0.f, 0 };
+        std::vector<uint32_t> vLodIndices = lodIndices(lod);
+        MeshOptimizer::OptimizeVertexCache(vLodIndices, m_vVertices3D.size());
+        clusterCount += MeshOptimizer::OptimizeOverdraw(vLodIndices, m_vVertices3D);
+        std::copy(vLodIndices.begin(), vLodIndices.end(), m_vIndices.begin() + lod.firstIndex);
+    }
+    MeshOptimizer::OptimizeVertexFetch(m_vIndices, m_vVertices3D);
 
-    //Copy
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    if (isLogged)
+    {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        const VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(lodIndices(m_vLods[0]), m_vVertices3D.size());
+        std::cout << m_ModelPath << " optimize: " << std::chrono::duration<float, std::milli>(endTime - startTime).count() << "ms"
+            << " ACMR " << before.acmr << " -> " << after.acmr
+            << " ATVR " << before.atvr << " -> " << after.atvr
+            << " (" << clusterCount << " overdraw clusters)\n";
+    }
+}
 
-    //Stop recording
-    EndSingleCommand(logicDevice, commandPool, graphicsQueue, commandBuffer);
+void Mesh::calculateBounds(const Vertex3D* pVertices, size_t vertexCount)
+{
+    if (vertexCount == 0)
+        return;
 
+    //center off the bounding box, good enough for lod selection
+    glm::vec3 minimum{ pVertices[0].pos };
+    glm::vec3 maximum{ pVertices[0].pos };
+    for (size_t vertex{}; vertex < vertexCount; ++vertex)
+    {
+        minimum = glm::min(minimum, pVertices[vertex].pos);
+        maximum = glm::max(maximum, pVertices[vertex].pos);
+    }
+    m_BoundsCenter = (minimum + maximum) * 0.5f;
+    const glm::vec3 halfSize = (maximum - minimum) * 0.5f;
+    m_BoundsHalfExtent = std::max(halfSize.x, std::max(halfSize.y, halfSize.z));
 
+    float radiusSquared{ 0.f };
+    for (size_t vertex{}; vertex < vertexCount; ++vertex)
+    {
+        const glm::vec3 offset = pVertices[vertex].pos - m_BoundsCenter;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    m_BoundsRadius = std::sqrt(radiusSquared);
 }
 
-void SceneObject::createBuffer(
-    VkPhysicalDevice& physicalDevice, VkDevice& logicDevice,
-    VkDeviceSize& bufferSize, VkBufferUsageFlags flags, 
-    VkMemoryPropertyFlags memryProps, 
-    VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory)
+glm::mat4 Mesh::GetVertexTransform()const
 {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = bufferSize;
-    bufferInfo.usage = flags;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; //only used by graphicsqueue so exlusive is enough
+    if (m_VertexFormat == VertexFormat::Packed3D)
+        return VertexPacker::GetDequantizeMatrix(m_BoundsCenter, m_BoundsHalfExtent);
+    return glm::mat4(1.f);
+}
 
-    if (vkCreateBuffer(logicDevice, &bufferInfo, nullptr, &vertexBuffer) != VK_SUCCESS)
-        throw std::runtime_error("creation off vertex buffer failed");
+uint32_t Mesh::GetImportFlags()const
+{
+    //everything that changes the vertices/indices loadModel builds has to end up in here
+    uint32_t flags{ 0 };
+    if (m_IsCollored) flags |= 1u << 0;
+    if (m_IsOptimized) flags |= 1u << 1;
+    flags |= (m_LodCount & 0xFF) << 8;
+    return flags;
+}
 
-    VkMemoryRequirements memRequirements{};
-    vkGetBufferMemoryRequirements(logicDevice, vertexBuffer, &memRequirements);
+//void Mesh::createCommandBuffers(VkDevice& logicDevice, VkCommandPool& commandPool, const int FrmasInFlight)
+//{
+//    m_vCommandBuffers.resize(FrmasInFlight);
+//
+//    VkCommandBufferAllocateInfo allocInfo{};
+//    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+//    allocInfo.commandPool        = commandPool;
+//    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+//    allocInfo.commandBufferCount = static_cast<uint32_t>(m_vCommandBuffers.size());
+//
+//    if (vkAllocateCommandBuffers(logicDevice, &allocInfo, m_vCommandBuffers.data()) != VK_SUCCESS)
+//    {
+//        throw std::runtime_error("Allocation off command buffer failed");
+//    }
+//
+//}
+
+void Mesh::createVertexBuffer(DeviceAllocator& allocator, MeshArena& arena, UploadBatch& uploadBatch)
+{
+    VkDeviceSize bufferSize = m_Is3D ? sizeof(m_vVertices3D[0]) * m_vVertices3D.size() : sizeof(m_vVertices2D[0]) * m_vVertices2D.size();
+    const void* srcData{ m_Is3D ? (void*)m_vVertices3D.data() : (void*)m_vVertices2D.data() };
+    if (m_pMeshCache)
+    {
+        bufferSize = sizeof(Vertex3D) * m_pMeshCache->GetVertexCount();
+        srcData    = m_pMeshCache->GetVertices();
+    }
+    m_VertexCount = static_cast<uint32_t>(m_Is3D ? bufferSize / sizeof(Vertex3D) : m_vVertices2D.size());
+
+    //packed formats get converted right before the upload, the cache and the cpu side stay full floats
+    std::vector<Vertex3DPacked> vPacked3D;
+    std::vector<Vertex2DPacked> vPacked2D;
+    if (m_VertexFormat == VertexFormat::Packed3D)
+    {
+        vPacked3D  = VertexPacker::Pack(static_cast<const Vertex3D*>(srcData), bufferSize / sizeof(Vertex3D), m_BoundsCenter, m_BoundsHalfExtent);
+        bufferSize = sizeof(Vertex3DPacked) * vPacked3D.size();
+        srcData    = vPacked3D.data();
+    }
+    else if (m_VertexFormat == VertexFormat::Packed2D)
+    {
+        vPacked2D  = VertexPacker::Pack(m_vVertices2D);
+        bufferSize = sizeof(Vertex2DPacked) * vPacked2D.size();
+        srcData    = vPacked2D.data();
+    }
 
-    //Memory allocation
-    VkMemoryAllocateInfo allocateInfo{};
-    allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.allocationSize  = memRequirements.size;
-    allocateInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, memryProps);
+    //the region is handed back to the ring once the batch completed
+    StagingRegion staging = uploadBatch.Stage(srcData, bufferSize);
 
-    if (vkAllocateMemory(logicDevice, &allocateInfo, nullptr, &vertexBufferMemory) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate memory for vertex buffer");
+    //Binding the vertex buffer will happen in the recordCommandBuffer()
+
+    m_VertexBytes     = bufferSize;
+    m_IsVertexInArena = arena.AllocateVertices(m_VertexFormat, bufferSize, m_VertexBuffer, m_VertexOffset);
+    if (!m_IsVertexInArena)
+    {
+        m_VertexOffset = 0;
+        allocator.CreateBuffer(bufferSize,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            m_VertexBuffer, m_VertexAllocation, MemoryCategory::Mesh);
+    }
 
-    //Filling the Vertex buffer
-    vkBindBufferMemory(logicDevice, vertexBuffer, vertexBufferMemory, 0);
+    uploadBatch.CopyBuffer(staging, m_VertexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, m_VertexOffset);
 }
 
-uint32_t SceneObject::findMemoryType(VkPhysicalDevice& physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+void Mesh::createIndexBuffer(DeviceAllocator& allocator, MeshArena& arena, UploadBatch& uploadBatch)
 {
-    VkPhysicalDeviceMemoryProperties memProps{};
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+    m_IndexCount = static_cast<uint32_t>(m_vIndices.size());
+    const void* srcData{ m_vIndices.data() };
+    if (m_vLods.empty())
+    {
+        //2D objects
+        m_vLods      = { MeshLod{ 0, m_IndexCount, 0.f, 0 } };
+        m_vSubmeshes = { Submesh{ 0, m_IndexCount, -1, 0 } };
+    }
 
-    for (uint32_t i{}; i < memProps.memoryTypeCount; ++i)
+    if (m_pMeshCache)
     {
-        if (typeFilter & (1 << i) && (memProps.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
+        m_IndexCount = m_pMeshCache->GetIndexCount();
+        srcData      = m_pMeshCache->GetIndices();
+    }
+
+    //every index fits in 16 bits when the vertex count does (needs createVertexBuffer to run first)
+    //0xFFFF itself stays unused so it can never collide with primitive restart
+    std::vector<uint16_t> vIndices16;
+    m_IndexType = VK_INDEX_TYPE_UINT32;
+    if (m_VertexCount <= 0xFFFF)
+    {
+        const uint32_t* pIndices = static_cast<const uint32_t*>(srcData);
+        vIndices16.assign(pIndices, pIndices + m_IndexCount);
+        srcData     = vIndices16.data();
+        m_IndexType = VK_INDEX_TYPE_UINT16;
     }
 
-    throw std::runtime_error("failed to find suitable memory type");
+    VkDeviceSize bufferSize = (m_IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)) * m_IndexCount;
+    StagingRegion staging = uploadBatch.Stage(srcData, bufferSize);
+
+    m_IndexBytes     = bufferSize;
+    m_IsIndexInArena = arena.AllocateIndices(m_VertexFormat, bufferSize, m_IndexBuffer, m_IndexOffset);
+    if (!m_IsIndexInArena)
+    {
+        m_IndexOffset = 0;
+        allocator.CreateBuffer(bufferSize,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            m_IndexBuffer, m_IndexAllocation, MemoryCategory::Mesh);
+    }
+
+    uploadBatch.CopyBuffer(staging, m_IndexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, m_IndexOffset);
+}
+
+void Mesh::beginUpload(DeviceAllocator& allocator, MeshArena& arena, const std::shared_ptr<UploadBatch>& pUploadBatch)
+{
+    //both copies go in the shared batch, whoever owns it submits once for every mesh that started this frame
+    m_pAllocator   = &allocator;
+    m_pArena       = &arena;
+    m_pUploadBatch = pUploadBatch;
+    createVertexBuffer(allocator, arena, *pUploadBatch);
+    createIndexBuffer(allocator, arena, *pUploadBatch); //the batch makes both copies visible to the vertex input
+
+    m_State = ResidencyState::Uploading;
+}
+
+void Mesh::finishUpload()
+{
+    //the staging regions already went back to the ring when the batch completed, the last owner frees its command buffer
+    m_pUploadBatch.reset();
+
+    m_pMeshCache.reset();
+    m_State = ResidencyState::Resident;
 }
@@ -2,26 +2,85 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "Structs.h"
+#include "MeshCache.h"
+#include "DeviceAllocator.h"
+#include "UploadBatch.h"
+#include "MeshArena.h"
 #include <string>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 class Pipeline;
+class Camera;
+class LoaderPool;
+class MeshRegistry;
 
-class SceneObject
+//how the obj file off a Mesh gets parsed
+enum class ObjLoadMode
+{
+    Serial,  //tinyobj::LoadObj on the calling thread
+    Parallel, //tinyobj_opt::parseObj spread over this load's share off the hardware threads, big meshes also get deduplicated in parallel
+    Streaming //tinyobj::LoadObjWithCallback, dedups while parsing so the peak memory is about the output mesh
+};
+
+//where a Mesh is between InitAsync and being drawable
+enum class ResidencyState
+{
+    Unloaded,
+    Loading,   //loadModel runs on a LoaderPool worker
+    Uploading, //copies are submitted, waiting on the upload fence
+    Resident   //buffers are filled and can be drawn
+};
+
+//called before the draws off a material, meshes without it draw every lod in one go
+using MaterialBinder = std::function<void(VkCommandBuffer commandBuffer, int32_t materialId)>;
+
+//geometry and gpu buffers off one model, shared between every SceneObject that uses it (see MeshRegistry)
+class Mesh
 {
 public:
-    SceneObject(const std::string& modelPath, const std::string& texturePath, bool isColored)
-        : m_ModelPath{ modelPath }, m_TexturePath{ texturePath }, m_IsCollored{ isColored }, m_Is3D{ true } {};
-    SceneObject(const std::vector<Vertex2D>& vVertex, const std::vector<uint32_t>& vIndices)
-        : m_vVertices2D{ vVertex }, m_vIndices{ vIndices }, m_Is3D{ false } {};
+    //optimizeMesh reorders triangles and vertices for the post transform cache and overdraw after loading (see MeshOptimizer)
+    //lodCount > 1 builds simplified levels off detail into the same vertex buffer (see MeshSimplifier)
+    //vertexFormat is the layout off the vertex buffer, it has to match the Pipeline it gets drawn with
+    Mesh(const std::string& modelPath, bool isColored, ObjLoadMode loadMode = ObjLoadMode::Serial,
+        bool optimizeMesh = false, uint32_t lodCount = 1, VertexFormat vertexFormat = VertexFormat::Float3D)
+        : m_Is3D{ true }, m_IsCollored{ isColored }, m_VertexFormat{ vertexFormat }, m_ModelPath{ modelPath },
+        m_LoadMode{ loadMode }, m_IsOptimized{ optimizeMesh }, m_LodCount{ lodCount } {};
+    Mesh(const std::vector<Vertex2D>& vVertex, const std::vector<uint32_t>& vIndices, VertexFormat vertexFormat = VertexFormat::Float2D)
+        : m_Is3D{ false }, m_vVertices2D{ vVertex }, m_vIndices{ vIndices }, m_VertexFormat{ vertexFormat } {};
 
-	~SceneObject() = default;
-    void Init(VkPhysicalDevice& m_PhysicalDevicem ,VkDevice& logicDevice, VkCommandPool& commandPool, const int FrmasInFlight, VkQueue& graphicsQueue);
-    void Record(VkCommandBuffer commandBuffer);
-    void Destroy(VkDevice& logicDevice);
+	~Mesh() = default;
+    //runs loadModel on the pool and returns right away, UpdateResidency does the upload once that is done
+    //the buffers are ranges off the arena, the mesh only gets its own buffers when the arena is full
+    std::shared_future<void> InitAsync(LoaderPool& loaderPool);
+    //call from the render thread every frame, never blocks: records the upload into pUploadBatch when the cpu data is ready
+    //(the caller submits the batch) and finishes once that batch completed. Returns true once the object can be drawn
+    bool UpdateResidency(DeviceAllocator& allocator, MeshArena& arena, const std::shared_ptr<UploadBatch>& pUploadBatch);
+    bool IsResident()const { return m_State == ResidencyState::Resident; };
+    ResidencyState GetState()const { return m_State; };
+    //pBindState skips the buffer binds when the previous mesh left the same ones bound, null always binds
+    void Record(VkCommandBuffer commandBuffer, const MaterialBinder& bindMaterial = nullptr, MeshBindState* pBindState = nullptr);
+    //picks the level off detail from how big the bounding sphere ends up on screen
+    void Record(VkCommandBuffer commandBuffer, const glm::mat4& world, const Camera& camera, float viewportHeight, const MaterialBinder& bindMaterial = nullptr,
+        MeshBindState* pBindState = nullptr);
+    void Destroy();
 
     VkBuffer GetVertexBuffer()const { return m_VertexBuffer; };
     VkBuffer GetIndexBuffer()const { return m_IndexBuffer; };
     std::vector<uint32_t> GetIndices()const { return m_vIndices; };
+    uint32_t GetLodCount()const { return static_cast<uint32_t>(m_vLods.size()); };
+    //shape/material ranges per lod, sorted by material
+    uint32_t GetSubmeshCount()const { return m_vLods.empty() ? 0 : static_cast<uint32_t>(m_vSubmeshes.size() / m_vLods.size()); };
+    const Submesh* GetSubmeshes(uint32_t lod)const { return m_vSubmeshes.data() + lod * GetSubmeshCount(); };
+    VertexFormat GetVertexFormat()const { return m_VertexFormat; };
+    //goes on the right off the object transform (ObjectUniformData), undoes the position quantization off packed formats
+    glm::mat4 GetVertexTransform()const;
+    //loader options that change the vertices/indices, also part off the MeshCache and MeshRegistry keys
+    uint32_t GetImportFlags()const;
+    const std::string& GetModelPath()const { return m_ModelPath; };
 
 private:
     bool m_Is3D{ true };
@@ -30,30 +89,109 @@ private:
     //std::vector<VkCommandBuffer> m_vCommandBuffers;
     std::vector<Vertex3D> m_vVertices3D;
     std::vector<Vertex2D> m_vVertices2D;
-    std::vector<uint32_t> m_vIndices;//use uint32_t when amount get above 65535
-    VkBuffer m_VertexBuffer;
-    VkDeviceMemory m_VertexBufferMemory;
-    VkBuffer m_IndexBuffer;
-    VkDeviceMemory m_IndexBufferMemory;
+    std::vector<uint32_t> m_vIndices;//uploaded as uint16_t when the vertex count allows it (see createIndexBuffer)
+    uint32_t m_IndexCount{ 0 };
+    uint32_t m_VertexCount{ 0 };
+    VkIndexType m_IndexType{ VK_INDEX_TYPE_UINT32 };
+    std::vector<MeshLod> m_vLods; //lod 0 is the full mesh
+    std::vector<Submesh> m_vSubmeshes; //GetSubmeshCount() per lod, lod after lod
+    glm::vec3 m_BoundsCenter{ 0.f };
+    float m_BoundsRadius{ 0.f };
+    float m_BoundsHalfExtent{ 0.f }; //largest half size off the bounding box, the Packed3D position scale
+    VertexFormat m_VertexFormat{ VertexFormat::Float3D };
+    std::unique_ptr<MeshCache> m_pMeshCache; //only mapped between loadModel and the buffer uploads on a warm start
+    VkBuffer m_VertexBuffer{ VK_NULL_HANDLE };
+    DeviceAllocation m_VertexAllocation;
+    VkBuffer m_IndexBuffer{ VK_NULL_HANDLE };
+    DeviceAllocation m_IndexAllocation;
+    DeviceAllocator* m_pAllocator{ nullptr }; //the one the buffers came from
+    MeshArena* m_pArena{ nullptr };
+    bool m_IsVertexInArena{ false }; //m_VertexBuffer is one off the shared arena buffers, the allocation stays empty
+    bool m_IsIndexInArena{ false };
+    VkDeviceSize m_VertexOffset{ 0 }; //bytes into the vertex/index buffer, 0 for own buffers
+    VkDeviceSize m_VertexBytes{ 0 };
+    VkDeviceSize m_IndexOffset{ 0 };
+    VkDeviceSize m_IndexBytes{ 0 };
+    ResidencyState m_State{ ResidencyState::Unloaded };
+    std::shared_future<void> m_LoadFuture;
+    std::chrono::high_resolution_clock::time_point m_LoadStartTime{};
+    //in flight upload, only touched on the render thread
+    std::shared_ptr<UploadBatch> m_pUploadBatch; //the batch the copies went into, until it completed
     std::string m_ModelPath{ "" };
-    std::string m_TexturePath;
+    ObjLoadMode m_LoadMode{ ObjLoadMode::Serial };
+    bool m_IsOptimized{ false };
+    uint32_t m_LodCount{ 1 };
+    static constexpr float m_LodPixelError{ 1.f }; //a lod is used as long as its error stays under this many pixels
+    static constexpr size_t m_ParallelDedupMinCorners{ 1 << 18 }; //below this the threads cost more than they save
+    static inline std::atomic<unsigned int> s_LoadsInFlight{ 0 }; //model loads submitted to the pool and not done, they split the hardware threads
 
 
     //init functions
-    void loadModel();
-    void createVertexBuffer(VkPhysicalDevice& physicalDevice, VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue);
-    void createIndexBuffer(VkPhysicalDevice& physicalDevice, VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue);
+    //numThreads is what the parallel parse and dedup off this one load may use
+    void loadModel(unsigned int numThreads);
+    bool loadStreaming();
+    void loadBuffered(unsigned int numThreads);
+    void optimizeMesh();
+    void calculateBounds(const Vertex3D* pVertices, size_t vertexCount);
+    uint32_t selectLod(const glm::mat4& world, const Camera& camera, float viewportHeight)const;
+    void drawLod(VkCommandBuffer commandBuffer, uint32_t lod, const MaterialBinder& bindMaterial, MeshBindState* pBindState);
+    void createVertexBuffer(DeviceAllocator& allocator, MeshArena& arena, UploadBatch& uploadBatch);
+    void createIndexBuffer(DeviceAllocator& allocator, MeshArena& arena, UploadBatch& uploadBatch);
+    void beginUpload(DeviceAllocator& allocator, MeshArena& arena, const std::shared_ptr<UploadBatch>& pUploadBatch);
+    void finishUpload();
     //void createCommandBuffers(VkDevice& logicDevice, VkCommandPool& commandPool, const int FrmasInFlight);
 
-    //HelperFunctions
-    VkCommandBuffer BeginSingleCommand(VkDevice& logicDevice, VkCommandPool& commandPool);
-    void EndSingleCommand(VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue, VkCommandBuffer& commandBuffer);
-    void copyBuffer(VkDevice& logicDevice, VkCommandPool& commandPool, VkQueue& graphicsQueue, VkBuffer& srcBuffer, VkBuffer& dstBuffer, VkDeviceSize& size);
-    void createBuffer(VkPhysicalDevice& m_PhysicalDevice, VkDevice& logicDevice, VkDeviceSize& bufferSize,
-        VkBufferUsageFlags flags,
-        VkMemoryPropertyFlags memryProps,
-        VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory);
-    uint32_t findMemoryType(VkPhysicalDevice& m_PhysicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
 
 };
+
+
+//one placement off a Mesh in the scene: the mesh is shared, the transform belongs to the object
+class SceneObject
+{
+public:
+    //identical model paths and import options end up on the same Mesh, only the first one loads and uploads it
+    SceneObject(MeshRegistry& registry, const std::string& modelPath, const std::string& texturePath, bool isColored, ObjLoadMode loadMode = ObjLoadMode::Serial,
+        bool optimizeMesh = false, uint32_t lodCount = 1, VertexFormat vertexFormat = VertexFormat::Float3D);
+    //2D objects keep their own unshared mesh
+    SceneObject(const std::vector<Vertex2D>& vVertex, const std::vector<uint32_t>& vIndices, VertexFormat vertexFormat = VertexFormat::Float2D)
+        : m_pMesh{ std::make_shared<Mesh>(vVertex, vIndices, vertexFormat) } {};
+
+    ~SceneObject() = default;
+    //does nothing when another object already started the shared mesh
+    void InitAsync(LoaderPool& loaderPool);
+    bool UpdateResidency(DeviceAllocator& allocator, MeshArena& arena, const std::shared_ptr<UploadBatch>& pUploadBatch);
+    bool IsResident()const { return m_pMesh && m_pMesh->IsResident(); };
+    void Record(VkCommandBuffer commandBuffer, const MaterialBinder& bindMaterial = nullptr, MeshBindState* pBindState = nullptr)
+    {
+        m_pMesh->Record(commandBuffer, bindMaterial, pBindState);
+    };
+    //world is the scene matrix, the object transform gets applied on top off it
+    void Record(VkCommandBuffer commandBuffer, const glm::mat4& world, const Camera& camera, float viewportHeight, const MaterialBinder& bindMaterial = nullptr,
+        MeshBindState* pBindState = nullptr)
+    {
+        m_pMesh->Record(commandBuffer, world * m_Transform, camera, viewportHeight, bindMaterial, pBindState);
+    };
+    //drops the reference, the gpu data goes away with the last object using it
+    void Destroy();
+
+    void SetTransform(const glm::mat4& transform) { m_Transform = transform; };
+    const glm::mat4& GetTransform()const { return m_Transform; };
+    const std::shared_ptr<Mesh>& GetMesh()const { return m_pMesh; };
+    const std::string& GetTexturePath()const { return m_TexturePath; };
+    //slot in the TextureManager array, the default (white) texture until the owner loads GetTexturePath()
+    void SetTextureIndex(uint32_t textureIndex) { m_TextureIndex = textureIndex; };
+    uint32_t GetTextureIndex()const { return m_TextureIndex; };
+    VkBuffer GetVertexBuffer()const { return m_pMesh->GetVertexBuffer(); };
+    VkBuffer GetIndexBuffer()const { return m_pMesh->GetIndexBuffer(); };
+    uint32_t GetLodCount()const { return m_pMesh->GetLodCount(); };
+    VertexFormat GetVertexFormat()const { return m_pMesh->GetVertexFormat(); };
+    glm::mat4 GetVertexTransform()const { return m_pMesh->GetVertexTransform(); };
+
+private:
+    std::shared_ptr<Mesh> m_pMesh;
+    MeshRegistry* m_pRegistry{ nullptr }; //null for unshared meshes
+    std::string m_TexturePath;
+    uint32_t m_TextureIndex{ 0 };
+    glm::mat4 m_Transform{ 1.f };
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+//Splits [0, count) in numThreads contiguous chunks and runs job(begin, end, chunkIndex) for each.
+//Chunk 0 runs on the calling thread and numThreads <= 1 never starts a thread, so code already running
+//on a LoaderPool worker can pass the share off the hardware it got without stacking threads on threads.
+//The chunks only depend on count and numThreads (empty ones still get called), so passes over the same range line up
+class ParallelChunks
+{
+public:
+    template<typename Job>
+    static void Run(size_t count, unsigned int numThreads, const Job& job)
+    {
+        numThreads = std::max(1u, numThreads);
+        const size_t chunkSize = (count + numThreads - 1) / numThreads;
+        auto runChunk = [&job, count, chunkSize](unsigned int chunk)
+            {
+                const size_t begin = std::min(count, chunk * chunkSize);
+                const size_t end   = std::min(count, begin + chunkSize);
+                job(begin, end, chunk);
+            };
+
+        std::vector<std::thread> vWorkers;
+        vWorkers.reserve(numThreads - 1);
+        for (unsigned int chunk{ 1 }; chunk < numThreads; ++chunk)
+            vWorkers.emplace_back(runChunk, chunk);
+        runChunk(0);
+        for (auto& worker : vWorkers)
+            worker.join();
+    }
+};
@@ -6,12 +6,13 @@
 #include "structs.h"
 
 
-Pipeline::Pipeline(const std::string& vertShaderPath, const std::string& fragShaderPath, bool is3D)
-    :m_VerShader{vertShaderPath}, m_FragShader{fragShaderPath}, m_Is3D{is3D}
+Pipeline::Pipeline(const std::string& vertShaderPath, const std::string& fragShaderPath, VertexFormat vertexFormat)
+    :m_VerShader{vertShaderPath}, m_FragShader{fragShaderPath}, m_VertexFormat{vertexFormat}
 {
 }
 
-void Pipeline::Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+void Pipeline::Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSetLayout textureSetLayout,
+    VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
 {
     auto vertShader = readFile(m_VerShader);
     auto fragShader = readFile(m_FragShader);
@@ -50,15 +51,24 @@ void Pipeline::Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescri
     //vertex format info 
     VkVertexInputBindingDescription bindingDescription;
     std::array<VkVertexInputAttributeDescription, 3>attributeDescription;
-    if (m_Is3D)
-    {
-       bindingDescription = Vertex3D::getBindDescription();
-       attributeDescription = Vertex3D::getAttributeDescriptions();
-    }
-    else
+    switch (m_VertexFormat)
     {
+    case VertexFormat::Float3D:
+        bindingDescription   = Vertex3D::getBindDescription();
+        attributeDescription = Vertex3D::getAttributeDescriptions();
+        break;
+    case VertexFormat::Packed3D:
+        bindingDescription   = Vertex3DPacked::getBindDescription();
+        attributeDescription = Vertex3DPacked::getAttributeDescriptions();
+        break;
+    case VertexFormat::Float2D:
         bindingDescription   = Vertex2D::getBindDescription();
         attributeDescription = Vertex2D::getAttributeDescriptions();
+        break;
+    case VertexFormat::Packed2D:
+        bindingDescription   = Vertex2DPacked::getBindDescription();
+        attributeDescription = Vertex2DPacked::getAttributeDescriptions();
+        break;
     }
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
@@ -154,18 +164,14 @@ void Pipeline::Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescri
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
 
-    VkPushConstantRange pushConstants{};
-    pushConstants.offset = 0;
-    pushConstants.size = sizeof(glm::mat4);
-    pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
     //Pipeline Layout ->used for dynamic behaviour like passing the tranform matrix to vertexshader or texture sampler to fragment shader
+    //every pipeline gets the same set layouts, so the texture set stays bound across pipeline switches
+    const VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, textureSetLayout };
     VkPipelineLayoutCreateInfo pipelineLayout{};
     pipelineLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayout.setLayoutCount = 1;
-    pipelineLayout.pSetLayouts = &descriptorSetLayout;
-    pipelineLayout.pushConstantRangeCount = 1;
-    pipelineLayout.pPushConstantRanges = &pushConstants;
+    pipelineLayout.setLayoutCount = 2;
+    pipelineLayout.pSetLayouts = setLayouts;
+    pipelineLayout.pushConstantRangeCount = 0; //the object transforms come from the dynamic uniform buffer
 
     if (vkCreatePipelineLayout(logicalDevice, &pipelineLayout, nullptr, &m_PipelineLayout) != VK_SUCCESS)
     {
@@ -206,15 +212,18 @@ void Pipeline::Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescri
 
 }
 
-void Pipeline::Record(VkCommandBuffer commandBuffer, VkDescriptorSet discriptorSet)
+void Pipeline::Record(VkCommandBuffer commandBuffer)
 {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+}
 
+void Pipeline::BindDrawData(VkCommandBuffer commandBuffer, VkDescriptorSet discriptorSet, uint32_t dynamicOffset)
+{
     vkCmdBindDescriptorSets(commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         m_PipelineLayout,
         0, 1, &discriptorSet,
-        0, nullptr);
+        1, &dynamicOffset);
 }
 
 void Pipeline::Destroy(VkDevice logicalDevice)
@@ -3,24 +3,31 @@
 #include <GLFW/glfw3.h>
 #include <string>
 #include <vector>
+#include "Structs.h"
 
 
 class Pipeline 
 {
 public:
-	Pipeline(const std::string& vertShaderPath, const std::string& fragShaderPath, bool is3D);
+	//vertexFormat has to match the SceneObjects drawn with this pipeline and the inputs off the vertex shader
+	Pipeline(const std::string& vertShaderPath, const std::string& fragShaderPath, VertexFormat vertexFormat);
 	~Pipeline() = default;
-	void Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
-	void Record(VkCommandBuffer commandBuffer, VkDescriptorSet discriptorSet);
+	//descriptorSetLayout is set 0 (per frame data), textureSetLayout set 1 (the TextureManager array)
+	void Init(VkDevice logicalDevice, VkExtent2D swapChainExtent, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSetLayout textureSetLayout,
+		VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
+	void Record(VkCommandBuffer commandBuffer);
+	//frame descriptor set with the per draw data at dynamicOffset (see FrameAllocator), once before every draw
+	void BindDrawData(VkCommandBuffer commandBuffer, VkDescriptorSet discriptorSet, uint32_t dynamicOffset);
 	void Destroy(VkDevice logicalDevice);
 
 	VkPipelineLayout GetPipelineLayout()const { return m_PipelineLayout; };
+	VertexFormat GetVertexFormat()const { return m_VertexFormat; };
 private:
 	std::string m_VerShader;
 	std::string m_FragShader;
 	VkPipelineLayout m_PipelineLayout;
 	VkPipeline m_GraphicsPipeline;
-	bool m_Is3D{ true };
+	VertexFormat m_VertexFormat{ VertexFormat::Float3D };
 
 
 	static std::vector<char> readFile(const std::string& filename);
@@ -0,0 +1,169 @@
+#include "StagingRing.h"
+#include <stdexcept>
+
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+
+StagingRing::StagingRing(DeviceAllocator& allocator, VkDevice logicDevice, VkDeviceSize capacity)
+    : m_Allocator{ allocator }, m_LogicalDevice{ logicDevice }, m_Capacity{ capacity }
+{
+    m_Allocator.CreateBuffer(m_Capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_Buffer, m_Allocation, MemoryCategory::Staging);
+}
+
+StagingRing::~StagingRing()
+{
+    while (!m_InFlight.empty())
+        retireOldest(true);
+
+    for (auto& overflow : m_vPendingOverflowBuffers)
+        m_Allocator.DestroyBuffer(overflow.first, overflow.second);
+    for (VkFence fence : m_vFreeFences)
+        vkDestroyFence(m_LogicalDevice, fence, nullptr);
+    m_Allocator.DestroyBuffer(m_Buffer, m_Allocation);
+}
+
+StagingRegion StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    StagingRegion region{};
+    region.size = size;
+
+    VkDeviceSize offset{};
+    while (!tryAllocate(size, alignment, offset))
+    {
+        //only what is already submitted can be waited for, the pending regions stay taken
+        if (m_InFlight.empty() || size > m_Capacity - m_PendingBytes)
+        {
+            VkBuffer buffer;
+            DeviceAllocation allocation;
+            m_Allocator.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                buffer, allocation, MemoryCategory::Staging);
+            m_vPendingOverflowBuffers.push_back({ buffer, allocation });
+
+            region.buffer = buffer;
+            region.pData  = allocation.pMapped;
+            return region;
+        }
+        ++m_StallCount;
+        retireOldest(true);
+    }
+
+    region.buffer = m_Buffer;
+    region.offset = offset;
+    region.pData  = static_cast<uint8_t*>(m_Allocation.pMapped) + offset;
+    return region;
+}
+
+uint64_t StagingRing::Submit(VkQueue queue, VkCommandBuffer commandBuffer)
+{
+    VkFence fence;
+    if (!m_vFreeFences.empty())
+    {
+        fence = m_vFreeFences.back();
+        m_vFreeFences.pop_back();
+    }
+    else
+    {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_LogicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+            throw std::runtime_error("failed to create staging fence");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &commandBuffer;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        m_vFreeFences.push_back(fence);
+        throw std::runtime_error("failed to submit upload command buffer");
+    }
+
+    Submission submission{ m_NextTicket++, fence, m_Head, m_PendingBytes, std::move(m_vPendingOverflowBuffers) };
+    m_vPendingOverflowBuffers.clear();
+    m_PendingBytes = 0;
+    m_InFlight.push_back(std::move(submission));
+    return m_InFlight.back().ticket;
+}
+
+bool StagingRing::IsComplete(uint64_t ticket)
+{
+    while (m_CompletedTicket < ticket && !m_InFlight.empty() && retireOldest(false))
+        ;
+    return m_CompletedTicket >= ticket;
+}
+
+void StagingRing::Wait(uint64_t ticket)
+{
+    while (m_CompletedTicket < ticket && !m_InFlight.empty())
+        retireOldest(true);
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    if (m_UsedBytes == 0)
+        m_Head = m_Tail = 0; //empty, start at the front so the whole ring is one piece
+
+    if (m_UsedBytes == 0 || m_Head > m_Tail)
+    {
+        //free space is [head, capacity) and [0, tail)
+        const VkDeviceSize aligned = alignUp(m_Head, alignment);
+        if (aligned + size <= m_Capacity)
+        {
+            offset = aligned;
+        }
+        else if (size <= m_Tail)
+        {
+            //skip the end off the ring, those bytes come back with this region
+            m_UsedBytes    += m_Capacity - m_Head;
+            m_PendingBytes += m_Capacity - m_Head;
+            m_Head = 0;
+            offset = 0;
+        }
+        else
+            return false;
+    }
+    else
+    {
+        //free space is [head, tail)
+        const VkDeviceSize aligned = alignUp(m_Head, alignment);
+        if (m_UsedBytes == m_Capacity || aligned + size > m_Tail)
+            return false;
+        offset = aligned;
+    }
+
+    const VkDeviceSize bytes = offset + size - m_Head;
+    m_UsedBytes    += bytes;
+    m_PendingBytes += bytes;
+    m_Head = offset + size;
+    return true;
+}
+
+bool StagingRing::retireOldest(bool wait)
+{
+    Submission& oldest = m_InFlight.front();
+    if (wait)
+        vkWaitForFences(m_LogicalDevice, 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+    else if (vkGetFenceStatus(m_LogicalDevice, oldest.fence) != VK_SUCCESS)
+        return false;
+
+    vkResetFences(m_LogicalDevice, 1, &oldest.fence);
+    m_vFreeFences.push_back(oldest.fence);
+    for (auto& overflow : oldest.vOverflowBuffers)
+        m_Allocator.DestroyBuffer(overflow.first, overflow.second);
+
+    if (oldest.bytes > 0) //an empty submission can be older than the last reset off head and tail
+        m_Tail = oldest.endOffset;
+    m_UsedBytes -= oldest.bytes;
+    m_CompletedTicket = oldest.ticket;
+    m_InFlight.pop_front();
+    return true;
+}
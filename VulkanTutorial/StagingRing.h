@@ -0,0 +1,79 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "DeviceAllocator.h"
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+//piece off the ring to write upload data into, copy from buffer + offset
+struct StagingRegion
+{
+    VkBuffer buffer{ VK_NULL_HANDLE };
+    VkDeviceSize offset{ 0 };
+    VkDeviceSize size{ 0 };
+    void* pData{ nullptr };
+};
+
+//One persistently mapped host visible buffer that every upload stages through.
+//Regions get handed out front to back and wrap around, a region is reused once the fence off
+//the submission that read it signaled. When the ring is full Allocate waits for the oldest submission (back-pressure)
+//Not thread safe, allocate and submit from the render thread
+class StagingRing
+{
+public:
+    StagingRing(DeviceAllocator& allocator, VkDevice logicDevice, VkDeviceSize capacity = m_DefaultCapacity);
+    //waits for everything still in flight
+    ~StagingRing();
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    //Regions belong to the next Submit, so allocate, record the copies and submit before anyone else allocates.
+    //Bigger than the ring (or than what is left with the pending regions) gets a one off buffer that lives until its submission is done
+    StagingRegion Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    //submits an ended command buffer with a fence owned by the ring, returns the ticket to poll/wait on
+    uint64_t Submit(VkQueue queue, VkCommandBuffer commandBuffer);
+    //never blocks
+    bool IsComplete(uint64_t ticket);
+    void Wait(uint64_t ticket);
+
+    VkDeviceSize GetCapacity()const { return m_Capacity; };
+    VkDeviceSize GetUsedBytes()const { return m_UsedBytes; };
+    //how many times Allocate had to wait for the gpu
+    uint32_t GetStallCount()const { return m_StallCount; };
+
+private:
+    struct Submission
+    {
+        uint64_t ticket;
+        VkFence fence;
+        VkDeviceSize endOffset; //ring head after the regions off this submission
+        VkDeviceSize bytes;     //ring bytes it holds, alignment and wrap padding included
+        std::vector<std::pair<VkBuffer, DeviceAllocation>> vOverflowBuffers;
+    };
+
+    static constexpr VkDeviceSize m_DefaultCapacity{ 32ull << 20 };
+
+    DeviceAllocator& m_Allocator;
+    VkDevice m_LogicalDevice;
+    VkBuffer m_Buffer{ VK_NULL_HANDLE };
+    DeviceAllocation m_Allocation;
+    VkDeviceSize m_Capacity;
+
+    VkDeviceSize m_Head{ 0 };
+    VkDeviceSize m_Tail{ 0 };
+    VkDeviceSize m_UsedBytes{ 0 };    //in flight + pending
+    VkDeviceSize m_PendingBytes{ 0 }; //allocated since the last Submit
+    std::vector<std::pair<VkBuffer, DeviceAllocation>> m_vPendingOverflowBuffers;
+
+    std::deque<Submission> m_InFlight; //in submission order
+    std::vector<VkFence> m_vFreeFences;
+    uint64_t m_NextTicket{ 1 };
+    uint64_t m_CompletedTicket{ 0 };
+    uint32_t m_StallCount{ 0 };
+
+    bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    //frees the oldest submission, waits for its fence first when wait is set. Returns false when it is not done yet
+    bool retireOldest(bool wait);
+};
@@ -4,13 +4,14 @@
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 #include <glm/glm.hpp>
 #include <array>
-#define GLM_ENABLE_EXPERIMENTAL //for hash mapping
-#include <glm/gtx/hash.hpp>
+#include <vector>
+#include <cstdint>
 
 struct QueueFamilyIndices
 {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t>presentFamily;
+	std::optional<uint32_t> transferFamily; //transfer only family, uploads fall back to the graphics queue without one
 
 	bool isComplete()const { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
@@ -75,6 +76,55 @@ struct Vertex3D
 
 };
 
+//layout off a vertex buffer, Mesh packs its vertices into it and Pipeline describes it to the shader
+enum class VertexFormat
+{
+	Float3D,  //Vertex3D, 32 bytes
+	Packed3D, //Vertex3DPacked, 16 bytes (needs shader/vertPacked.spv)
+	Float2D,  //Vertex2D, 28 bytes
+	Packed2D  //Vertex2DPacked, 12 bytes (same shader as Float2D)
+};
+
+//position as snorm16 inside the bounding box off the mesh (the dequantization goes in the object transform)
+//octahedral snorm16 normal and half float uvs
+struct Vertex3DPacked
+{
+	int16_t pos[4]; //w is padding, 3 component 16 bit formats are hardly supported
+	int16_t normal[2];
+	uint16_t texcoord[2];
+
+	static VkVertexInputBindingDescription getBindDescription()
+	{
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding   = 0;
+		bindingDescription.stride    = sizeof(Vertex3DPacked);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescription;
+	}
+
+	static const int attributeNum{ 3 };
+	static std::array<VkVertexInputAttributeDescription, attributeNum> getAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, attributeNum> attributeDescriptions{};
+		attributeDescriptions[0].binding  = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format   = VK_FORMAT_R16G16B16A16_SNORM;
+		attributeDescriptions[0].offset   = offsetof(Vertex3DPacked, pos);
+
+		attributeDescriptions[1].binding  = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format   = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset   = offsetof(Vertex3DPacked, normal);
+
+		attributeDescriptions[2].binding  = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format   = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[2].offset   = offsetof(Vertex3DPacked, texcoord);
+
+		return attributeDescriptions;
+	}
+};
+
 struct Vertex2D
 {
 	glm::vec2 pos;
@@ -124,16 +174,63 @@ struct Vertex2D
 
 };
 
-//CREATING A HASH FOR THE UNORDERD MAP IN THE LOAD OBJ
-namespace std {
-	template<> struct hash<Vertex3D> {
-		size_t operator()(Vertex3D const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texcoord) << 1);
-		}
-	};
-}
+//range off the shared index buffer that draws one level off detail
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error; //largest deviation from the full mesh in model units
+	uint32_t padding;
+};
+
+//range off one shape/material inside a lod, the ranges off a lod are sorted by material
+struct Submesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t materialId; //index into the .mtl materials, -1 when the faces have none
+	uint32_t shapeId;   //g/o group in the obj file
+};
+
+//half float position and uvs, the normal as snorm8 (the 4th byte is padding)
+//the shader reads it as the same vec2/vec3/vec2 as Vertex2D
+struct Vertex2DPacked
+{
+	uint16_t pos[2];
+	int8_t normal[4];
+	uint16_t texcoord[2];
+
+	static VkVertexInputBindingDescription getBindDescription()
+	{
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding   = 0;
+		bindingDescription.stride    = sizeof(Vertex2DPacked);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescription;
+	}
+
+	static const int attributeNum{ 3 };
+	static std::array<VkVertexInputAttributeDescription, attributeNum> getAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, attributeNum> attributeDescriptions{};
+		attributeDescriptions[0].binding  = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format   = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[0].offset   = offsetof(Vertex2DPacked, pos);
+
+		attributeDescriptions[1].binding  = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format   = VK_FORMAT_R8G8B8A8_SNORM;
+		attributeDescriptions[1].offset   = offsetof(Vertex2DPacked, normal);
+
+		attributeDescriptions[2].binding  = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format   = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[2].offset   = offsetof(Vertex2DPacked, texcoord);
+
+		return attributeDescriptions;
+	}
+};
 
 struct UniformBufferObject
 {
@@ -141,4 +238,11 @@ struct UniformBufferObject
 	alignas(16) glm::mat4 view; // But it can break when using nested variables, (like selfmade structs)
 	alignas(16) glm::mat4 proj; //Safer to always manually allign
 
+};
+
+//per draw data, pushed into the FrameAllocator and bound with a dynamic offset (binding 2)
+struct ObjectUniformData
+{
+	alignas(16) glm::mat4 model; //object transform, goes on top off UniformBufferObject::model
+	uint32_t textureIndex;       //slot in the TextureManager array
 };
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "Test.h"
+#include "DeviceAllocator.h"
+#include <memory>
+#include <map>
+#include <stdexcept>
+
+
+//memory types off a made up discrete gpu, the allocator only sees them through BlockCallbacks
+enum FakeMemoryType : uint32_t
+{
+    DeviceLocal, //heap 0
+    HostVisible, //heap 1, mapped
+    Lazy,        //heap 0, transient attachments
+};
+
+static const VkDeviceSize Granularity{ 1024 };
+
+//hands out numbered handles instead off vkAllocateMemory, host visible blocks get real (untouched) memory to point into
+class FakeDevice
+{
+public:
+    FakeDevice()
+    {
+        m_MemoryProperties.memoryHeapCount = 2;
+        m_MemoryProperties.memoryHeaps[0] = { 1ull << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+        m_MemoryProperties.memoryHeaps[1] = { 256ull << 20, 0 }; //blocks are an 8th off the heap here, 32 MiB
+        m_MemoryProperties.memoryTypeCount = 3;
+        m_MemoryProperties.memoryTypes[DeviceLocal] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+        m_MemoryProperties.memoryTypes[HostVisible] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1 };
+        m_MemoryProperties.memoryTypes[Lazy] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, 0 };
+
+        m_Callbacks.allocate = [this](uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& pMapped)
+            {
+                if (m_IsOutOfMemory)
+                    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+                memory = (VkDeviceMemory)(uintptr_t)m_NextHandle++; //non dispatchable handles are uint64_t on 32 bit
+                Block& block = m_Blocks[memory];
+                block.size = size;
+                if (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+                    block.pData.reset(new uint8_t[size]);
+                pMapped = block.pData.get();
+                ++allocateCount;
+                return VK_SUCCESS;
+            };
+        m_Callbacks.free = [this](VkDeviceMemory memory)
+            {
+                if (m_Blocks.erase(memory) == 0)
+                    throw std::runtime_error("freed a block twice");
+                ++freeCount;
+            };
+    }
+
+    const VkPhysicalDeviceMemoryProperties& GetMemoryProperties()const { return m_MemoryProperties; };
+    const DeviceAllocator::BlockCallbacks& GetCallbacks()const { return m_Callbacks; };
+    size_t GetLiveBlockCount()const { return m_Blocks.size(); };
+    VkDeviceSize GetBlockSize(VkDeviceMemory memory)const { return m_Blocks.at(memory).size; };
+    const uint8_t* GetBlockData(VkDeviceMemory memory)const { return m_Blocks.at(memory).pData.get(); };
+    void SetOutOfMemory(bool isOutOfMemory) { m_IsOutOfMemory = isOutOfMemory; };
+
+    uint32_t allocateCount{ 0 };
+    uint32_t freeCount{ 0 };
+
+private:
+    struct Block
+    {
+        VkDeviceSize size{ 0 };
+        std::unique_ptr<uint8_t[]> pData;
+    };
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+    DeviceAllocator::BlockCallbacks m_Callbacks;
+    std::map<VkDeviceMemory, Block> m_Blocks;
+    uint64_t m_NextHandle{ 1 };
+    bool m_IsOutOfMemory{ false };
+};
+
+static VkMemoryRequirements requirements(VkDeviceSize size, VkDeviceSize alignment = 16, uint32_t typeBits = 0x7)
+{
+    return VkMemoryRequirements{ size, alignment, typeBits };
+}
+
+
+TEST_CASE(DeviceAllocator_BestFitPicksTheTightestHole)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+    const VkMemoryPropertyFlags local{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+
+    //holes off 5000 and 3000 bytes with allocations in between, a 2900 byte request belongs in the smaller one
+    std::vector<DeviceAllocation> vAllocations;
+    for (VkDeviceSize size : { 1024, 5120, 1024, 3072, 1024 })
+        vAllocations.push_back(allocator.Allocate(requirements(size), local, ResourceKind::Linear, MemoryCategory::Mesh));
+    const VkDeviceSize smallHoleOffset = vAllocations[3].offset;
+    allocator.Free(vAllocations[1]);
+    allocator.Free(vAllocations[3]);
+
+    DeviceAllocation fitted = allocator.Allocate(requirements(2900), local, ResourceKind::Linear, MemoryCategory::Mesh);
+    CHECK(fitted.memory == vAllocations[0].memory);
+    CHECK(fitted.offset == smallHoleOffset);
+    CHECK(fitted.memoryType == DeviceLocal);
+    CHECK(device.allocateCount == 1);
+
+    const DeviceAllocatorStats stats = allocator.GetStats();
+    CHECK(stats.blockCount == 1);
+    CHECK(stats.allocationCount == 4);
+    CHECK(stats.usedBytes == 1024 * 3 + 2900);
+    CHECK(stats.freeBytes + stats.usedBytes == stats.blockBytes);
+}
+
+TEST_CASE(DeviceAllocator_FreeRangesCoalesce)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+
+    std::vector<DeviceAllocation> vAllocations;
+    for (uint32_t i{}; i < 8; ++i)
+        vAllocations.push_back(allocator.Allocate(requirements(4096), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Texture));
+
+    //every other one first: free space in pieces
+    for (uint32_t i : { 1, 3, 5 })
+        allocator.Free(vAllocations[i]);
+    CHECK(allocator.GetStats().fragmentation > 0.f);
+
+    //then the ones in between, the neighbours have to merge from both sides
+    for (uint32_t i : { 4, 2, 6, 0, 7 })
+        allocator.Free(vAllocations[i]);
+    const DeviceAllocatorStats stats = allocator.GetStats();
+    CHECK(stats.allocationCount == 0);
+    CHECK(stats.usedBytes == 0);
+    CHECK(stats.largestFreeRange == stats.blockBytes);
+    CHECK(stats.fragmentation == 0.f);
+    CHECK(stats.blockCount == 1); //the last empty block is kept for the next allocation
+    CHECK(vAllocations[0].blockId == 0); //Free resets the allocation
+}
+
+TEST_CASE(DeviceAllocator_ReleaseRangeMergesBothNeighbours)
+{
+    std::vector<FreeRange> vFreeRanges{ { 0, 100 }, { 200, 100 } };
+    DeviceAllocator::ReleaseRange(vFreeRanges, 100, 100);
+    CHECK(vFreeRanges.size() == 1 && vFreeRanges[0].offset == 0 && vFreeRanges[0].size == 300);
+
+    VkDeviceSize offset{ 0 };
+    CHECK(DeviceAllocator::AllocateRange(vFreeRanges, 50, 64, offset));
+    CHECK(offset == 0);
+    CHECK(DeviceAllocator::AllocateRange(vFreeRanges, 50, 64, offset));
+    CHECK(offset == 64); //the padding from 50 to 64 stays free
+    CHECK(vFreeRanges.size() == 2 && vFreeRanges[0].offset == 50 && vFreeRanges[0].size == 14);
+    CHECK(!DeviceAllocator::AllocateRange(vFreeRanges, 300, 1, offset));
+}
+
+TEST_CASE(DeviceAllocator_OptimalImagesOwnTheirGranularityPages)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+    const VkMemoryPropertyFlags local{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+
+    DeviceAllocation buffer = allocator.Allocate(requirements(100), local, ResourceKind::Linear, MemoryCategory::Mesh);
+    DeviceAllocation image = allocator.Allocate(requirements(1500, 256), local, ResourceKind::OptimalImage, MemoryCategory::Texture);
+    std::vector<DeviceAllocation> vBuffers;
+    for (uint32_t i{}; i < 16; ++i)
+        vBuffers.push_back(allocator.Allocate(requirements(100), local, ResourceKind::Linear, MemoryCategory::Mesh));
+
+    CHECK(buffer.offset == 0);
+    CHECK(image.offset % Granularity == 0);
+    CHECK(image.size % Granularity == 0 && image.size >= 1500);
+
+    //no buffer may share a page with the image, even though the holes in front off it are big enough
+    const VkDeviceSize firstPage = image.offset / Granularity;
+    const VkDeviceSize lastPage  = (image.offset + image.size - 1) / Granularity;
+    bool isSeparate{ true };
+    for (const DeviceAllocation& allocation : vBuffers)
+    {
+        const VkDeviceSize first = allocation.offset / Granularity;
+        const VkDeviceSize last  = (allocation.offset + allocation.size - 1) / Granularity;
+        isSeparate = isSeparate && (last < firstPage || first > lastPage);
+    }
+    CHECK(isSeparate);
+}
+
+TEST_CASE(DeviceAllocator_LargeAndLazyAllocationsAreDedicated)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+
+    //over half a block (64 MiB on the big heap) gets its own VkDeviceMemory off exactly that size
+    const VkDeviceSize bigSize{ 40ull << 20 };
+    DeviceAllocation big = allocator.Allocate(requirements(bigSize), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Texture);
+    CHECK(big.offset == 0);
+    CHECK(device.GetBlockSize(big.memory) == bigSize);
+
+    DeviceAllocation lazy = allocator.Allocate(requirements(4096, 16, 1 << Lazy), VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, ResourceKind::OptimalImage,
+        MemoryCategory::Attachment);
+    CHECK(lazy.memoryType == Lazy);
+    CHECK(allocator.IsLazilyAllocated(lazy));
+    CHECK(device.GetBlockSize(lazy.memory) == 4096);
+    CHECK(allocator.GetStats().dedicatedBlockCount == 2);
+
+    //dedicated blocks go straight back to the device
+    allocator.Free(big);
+    allocator.Free(lazy);
+    CHECK(device.freeCount == 2);
+    CHECK(device.GetLiveBlockCount() == 0);
+    CHECK(allocator.GetBudget().categoryBytes[static_cast<size_t>(MemoryCategory::Texture)] == 0);
+}
+
+TEST_CASE(DeviceAllocator_SmallHeapsGetSmallerBlocks)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+
+    CHECK(allocator.GetBlockSize(DeviceLocal) == 64ull << 20);
+    CHECK(allocator.GetBlockSize(HostVisible) == 32ull << 20);
+
+    //20 MiB is over half off the 32 MiB host visible blocks, so it is dedicated there
+    DeviceAllocation staging = allocator.Allocate(requirements(20ull << 20, 16, 1 << HostVisible), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        ResourceKind::Linear, MemoryCategory::Staging);
+    CHECK(allocator.GetStats().dedicatedBlockCount == 1);
+    allocator.Free(staging);
+}
+
+TEST_CASE(DeviceAllocator_HostVisiblePointersFollowTheOffset)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+    const VkMemoryPropertyFlags host{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+
+    DeviceAllocation first = allocator.Allocate(requirements(300), host, ResourceKind::Linear, MemoryCategory::Uniform);
+    DeviceAllocation second = allocator.Allocate(requirements(300, 256), host, ResourceKind::Linear, MemoryCategory::Uniform);
+    DeviceAllocation local = allocator.Allocate(requirements(300), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Mesh);
+
+    CHECK(second.offset == 512);
+    CHECK(first.pMapped == device.GetBlockData(first.memory));
+    CHECK(static_cast<uint8_t*>(second.pMapped) == device.GetBlockData(second.memory) + second.offset);
+    CHECK(local.pMapped == nullptr);
+}
+
+TEST_CASE(DeviceAllocator_KeepsOneEmptyBlockPerType)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+    const VkMemoryPropertyFlags local{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+
+    //two 30 MiB allocations fill the first 64 MiB block, the third needs a second one
+    std::vector<DeviceAllocation> vAllocations;
+    for (uint32_t i{}; i < 3; ++i)
+        vAllocations.push_back(allocator.Allocate(requirements(30ull << 20), local, ResourceKind::Linear, MemoryCategory::Mesh));
+    CHECK(device.allocateCount == 2);
+
+    allocator.Free(vAllocations[2]);
+    CHECK(device.freeCount == 1); //the first block is still there, so the empty one goes
+    allocator.Free(vAllocations[0]);
+    allocator.Free(vAllocations[1]);
+    CHECK(device.freeCount == 1); //but the last one stays around
+    CHECK(device.GetLiveBlockCount() == 1);
+
+    DeviceAllocation again = allocator.Allocate(requirements(30ull << 20), local, ResourceKind::Linear, MemoryCategory::Mesh);
+    CHECK(device.allocateCount == 2);
+    allocator.Free(again);
+}
+
+TEST_CASE(DeviceAllocator_ErrorsThrow)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+
+    bool isThrown{ false };
+    try { allocator.Allocate(requirements(64, 16, 1 << HostVisible), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Other); }
+    catch (const std::runtime_error&) { isThrown = true; }
+    CHECK(isThrown);
+
+    device.SetOutOfMemory(true);
+    isThrown = false;
+    try { allocator.Allocate(requirements(64), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Other); }
+    catch (const std::runtime_error&) { isThrown = true; }
+    CHECK(isThrown);
+    CHECK(allocator.GetStats().blockCount == 0);
+}
+
+TEST_CASE(DeviceAllocator_DestructorReturnsEveryBlock)
+{
+    FakeDevice device;
+    {
+        DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+        allocator.Allocate(requirements(100), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Mesh);
+        allocator.Allocate(requirements(100), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, ResourceKind::Linear, MemoryCategory::Staging);
+        allocator.Allocate(requirements(50ull << 20), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Texture);
+    }
+    CHECK(device.allocateCount == 3);
+    CHECK(device.GetLiveBlockCount() == 0);
+}
+
+TEST_CASE(DeviceAllocator_SoftBudgetEvictsUntilUnder)
+{
+    FakeDevice device;
+    DeviceAllocator allocator{ device.GetMemoryProperties(), Granularity, device.GetCallbacks() };
+    const VkDeviceSize textureSize{ 40ull << 20 }; //dedicated, so freeing one gives its block back
+
+    std::vector<DeviceAllocation> vTextures;
+    for (uint32_t i{}; i < 3; ++i)
+        vTextures.push_back(allocator.Allocate(requirements(textureSize), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::OptimalImage, MemoryCategory::Texture));
+    //host visible memory is not on a device local heap, it does not count
+    DeviceAllocation staging = allocator.Allocate(requirements(1 << 20, 16, 1 << HostVisible), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, ResourceKind::Linear,
+        MemoryCategory::Staging);
+
+    std::vector<VkDeviceSize> vRequests;
+    auto evictOne = [&](VkDeviceSize bytesOverBudget)
+        {
+            vRequests.push_back(bytesOverBudget);
+            for (DeviceAllocation& texture : vTextures)
+            {
+                if (texture.blockId != 0)
+                {
+                    allocator.Free(texture);
+                    return;
+                }
+            }
+        };
+    allocator.AddEvictionCallback(evictOne);
+    allocator.AddEvictionCallback(evictOne);
+    allocator.AddEvictionCallback(evictOne);
+
+    CHECK(!allocator.EnforceSoftBudget()); //off by default
+    CHECK(vRequests.empty());
+
+    //120 MiB used, 100 allowed: the first eviction gets asked for 20 MiB and frees 40, the others are not needed
+    allocator.SetSoftBudget(100ull << 20);
+    CHECK(!allocator.EnforceSoftBudget());
+    CHECK(vRequests.size() == 1 && vRequests[0] == 20ull << 20);
+    CHECK(allocator.GetBudget().deviceLocalUsage == 80ull << 20);
+
+    //50 MiB allowed: both remaining textures have to go and the usage ends at 0, under budget again
+    vRequests.clear();
+    allocator.SetSoftBudget(50ull << 20);
+    CHECK(!allocator.EnforceSoftBudget());
+    CHECK(vRequests.size() == 1 && vRequests[0] == 30ull << 20);
+    allocator.SetSoftBudget(1);
+    CHECK(!allocator.EnforceSoftBudget());
+    CHECK(allocator.GetBudget().deviceLocalUsage == 0);
+
+    //nothing left to evict: still over
+    DeviceAllocation mesh = allocator.Allocate(requirements(1024), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Linear, MemoryCategory::Mesh);
+    vRequests.clear();
+    CHECK(allocator.EnforceSoftBudget());
+    CHECK(vRequests.size() == 3);
+    allocator.Free(mesh);
+    allocator.Free(staging);
+
+    //the empty blocks Free keeps around (one per type) go back before anything gets evicted
+    vRequests.clear();
+    CHECK(device.GetLiveBlockCount() == 2);
+    CHECK(!allocator.EnforceSoftBudget());
+    CHECK(vRequests.empty());
+    CHECK(device.GetLiveBlockCount() == 0);
+}
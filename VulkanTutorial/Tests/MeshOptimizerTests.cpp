@@ -0,0 +1,75 @@
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshOptimizer.h"
+
+
+TEST_CASE(MeshOptimizer_VertexCacheKeepsTrianglesAndLowersAcmr)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(40, false, true, vertices, indices);
+    const auto vTriangles = TestMeshes::GetTriangleSet(indices, vertices);
+    const VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+
+    MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+    const VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+
+    CHECK(TestMeshes::GetTriangleSet(indices, vertices) == vTriangles);
+    CHECK(after.acmr < before.acmr * 0.5f);
+    CHECK(after.acmr < 0.8f); //a regular grid can get close to 0.5
+}
+
+TEST_CASE(MeshOptimizer_OverdrawKeepsTrianglesAndCacheEfficiency)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(40, true, true, vertices, indices);
+    const auto vTriangles = TestMeshes::GetTriangleSet(indices, vertices);
+    const float shuffledAcmr = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size()).acmr;
+
+    MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+    const float cacheAcmr = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size()).acmr;
+    const size_t clusterCount = MeshOptimizer::OptimizeOverdraw(indices, vertices, 1.05f);
+
+    CHECK(clusterCount >= 1);
+    CHECK(TestMeshes::GetTriangleSet(indices, vertices) == vTriangles);
+    //the threshold holds per cluster, reordering them costs a few extra misses at the seams
+    const float overdrawAcmr = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size()).acmr;
+    CHECK(overdrawAcmr <= cacheAcmr * 1.1f);
+    CHECK(overdrawAcmr < shuffledAcmr * 0.5f);
+}
+
+TEST_CASE(MeshOptimizer_VertexFetchOrdersByFirstUse)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(16, true, true, vertices, indices);
+    vertices.push_back(Vertex3D{}); //unused, has to be dropped
+    const auto vTriangles = TestMeshes::GetTriangleSet(indices, vertices);
+
+    MeshOptimizer::OptimizeVertexFetch(indices, vertices);
+
+    CHECK(vertices.size() == 17 * 17);
+    CHECK(TestMeshes::GetTriangleSet(indices, vertices) == vTriangles);
+    uint32_t nextNew{ 0 };
+    bool isFirstUseOrder{ true };
+    for (uint32_t index : indices)
+    {
+        if (index == nextNew)
+            ++nextNew;
+        else
+            isFirstUseOrder = isFirstUseOrder && index < nextNew;
+    }
+    CHECK(isFirstUseOrder);
+}
+
+TEST_CASE(MeshOptimizer_EmptyMeshIsLeftAlone)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    MeshOptimizer::OptimizeVertexCache(indices, 0);
+    MeshOptimizer::OptimizeOverdraw(indices, vertices);
+    MeshOptimizer::OptimizeVertexFetch(indices, vertices);
+    CHECK(indices.empty());
+    CHECK(vertices.empty());
+}
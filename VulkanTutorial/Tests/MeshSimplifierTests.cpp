@@ -0,0 +1,87 @@
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+
+
+TEST_CASE(MeshSimplifier_FlatGridCollapsesWithoutError)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(16, false, false, vertices, indices);
+
+    float resultError{ -1.f };
+    const std::vector<uint32_t> simplified = MeshSimplifier::Simplify(indices, vertices, indices.size() / 4, 0.01f, resultError);
+
+    CHECK(simplified.size() % 3 == 0);
+    CHECK(simplified.size() <= indices.size() / 4);
+    CHECK(resultError >= 0.f && resultError < 1e-4f); //every collapse on a plane is free
+}
+
+TEST_CASE(MeshSimplifier_ErrorLimitStopsCollapsing)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(32, true, false, vertices, indices);
+
+    float looseError{ 0.f }, tightError{ 0.f };
+    const size_t looseCount = MeshSimplifier::Simplify(indices, vertices, 0, 1.f, looseError).size();
+    const size_t tightCount = MeshSimplifier::Simplify(indices, vertices, 0, 0.001f, tightError).size();
+
+    CHECK(tightError <= 0.001f);
+    CHECK(tightCount > looseCount);
+    CHECK(tightCount < indices.size());
+}
+
+TEST_CASE(MeshSimplifier_LodChainShrinksAndStaysInRange)
+{
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(32, true, true, vertices, indices);
+    const size_t fullCount = indices.size();
+
+    const std::vector<MeshLod> vLods = MeshSimplifier::BuildLodChain(indices, vertices, 4);
+
+    CHECK(vLods.size() == 4); //a bumpy grid still has plenty to collapse at a quarter
+    CHECK(vLods[0].firstIndex == 0 && vLods[0].indexCount == fullCount && vLods[0].error == 0.f);
+    bool isShrinking{ true }, isInRange{ true };
+    for (size_t lod{ 1 }; lod < vLods.size(); ++lod)
+    {
+        isShrinking = isShrinking && vLods[lod].indexCount < vLods[lod - 1].indexCount && vLods[lod].error >= vLods[lod - 1].error;
+        isInRange = isInRange && vLods[lod].indexCount % 3 == 0 && vLods[lod].firstIndex + vLods[lod].indexCount <= indices.size();
+        for (uint32_t i{}; isInRange && i < vLods[lod].indexCount; ++i)
+            isInRange = indices[vLods[lod].firstIndex + i] < vertices.size();
+    }
+    CHECK(isShrinking);
+    CHECK(isInRange);
+}
+
+TEST_CASE(MeshSimplifier_SubmeshLodsKeepTheirMaterial)
+{
+    //two submeshes: the left and the right half off the grid
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    TestMeshes::BuildGrid(32, true, false, vertices, indices);
+    const uint32_t halfCount = static_cast<uint32_t>(indices.size() / 6) * 3;
+    std::vector<Submesh> vSubmeshes{ { 0, halfCount, 0, 0 }, { halfCount, static_cast<uint32_t>(indices.size()) - halfCount, 1, 0 } };
+    const std::vector<uint32_t> vOriginal = indices;
+
+    std::vector<MeshLod> vLods = MeshSimplifier::BuildLodChain(indices, vertices, 3, vSubmeshes);
+
+    CHECK(vSubmeshes.size() == vLods.size() * 2);
+    bool isOwnVertices{ true };
+    for (size_t submesh{}; submesh < vSubmeshes.size(); ++submesh)
+    {
+        //a collapse only moves onto existing vertices, so a submesh can only use vertices its lod 0 range used
+        const Submesh& original = vSubmeshes[submesh % 2];
+        const Submesh& range = vSubmeshes[submesh];
+        CHECK(range.materialId == original.materialId);
+        for (uint32_t i{}; i < range.indexCount; ++i)
+        {
+            const uint32_t index = indices[range.firstIndex + i];
+            isOwnVertices = isOwnVertices && std::find(vOriginal.begin() + original.firstIndex,
+                vOriginal.begin() + original.firstIndex + original.indexCount, index) != vOriginal.begin() + original.firstIndex + original.indexCount;
+        }
+    }
+    CHECK(isOwnVertices);
+}
@@ -0,0 +1,89 @@
+#include "Test.h"
+#include "MipBuilder.h"
+#include <algorithm>
+#include <cstdlib>
+
+
+//black and white texels in a checker pattern, with the white ones fully transparent if asked
+static std::vector<uint8_t> buildChecker(uint32_t width, uint32_t height, bool isWhiteTransparent = false)
+{
+    std::vector<uint8_t> vPixels(size_t(width) * height * 4);
+    for (uint32_t y{}; y < height; ++y)
+        for (uint32_t x{}; x < width; ++x)
+        {
+            const uint8_t value = (x + y) % 2 ? 255 : 0;
+            uint8_t* pTexel = &vPixels[(size_t(y) * width + x) * 4];
+            pTexel[0] = pTexel[1] = pTexel[2] = value;
+            pTexel[3] = isWhiteTransparent && value ? 0 : 255;
+        }
+    return vPixels;
+}
+
+
+TEST_CASE(MipBuilder_MipCountGoesDownToOneTexel)
+{
+    CHECK(MipBuilder::CalculateMipCount(1, 1) == 1);
+    CHECK(MipBuilder::CalculateMipCount(256, 256) == 9);
+    CHECK(MipBuilder::CalculateMipCount(256, 64) == 9);
+    CHECK(MipBuilder::CalculateMipCount(300, 7) == 9);
+}
+
+TEST_CASE(MipBuilder_LevelsArePackedAndAligned)
+{
+    const std::vector<uint8_t> vSource = buildChecker(37, 5);
+    std::vector<TextureCacheMip> vMips;
+    std::vector<uint8_t> vPixels;
+    MipBuilder::Build(vSource.data(), 37, 5, true, vMips, vPixels, 1);
+
+    CHECK(vMips.size() == 6);
+    bool isLaidOut{ true };
+    for (size_t mip{}; mip < vMips.size(); ++mip)
+    {
+        const TextureCacheMip& level = vMips[mip];
+        isLaidOut = isLaidOut && level.width == std::max(37u >> mip, 1u) && level.height == std::max(5u >> mip, 1u)
+            && level.size == uint64_t(level.width) * level.height * 4 && level.offset % 16 == 0
+            && (mip == 0 || level.offset >= vMips[mip - 1].offset + vMips[mip - 1].size);
+    }
+    CHECK(isLaidOut);
+    CHECK(vMips.back().offset + vMips.back().size <= vPixels.size());
+    CHECK(std::equal(vSource.begin(), vSource.end(), vPixels.begin())); //level 0 is the source
+}
+
+TEST_CASE(MipBuilder_SrgbAveragesInLinearSpace)
+{
+    const std::vector<uint8_t> vSource = buildChecker(64, 64);
+    std::vector<TextureCacheMip> vSrgbMips, vLinearMips;
+    std::vector<uint8_t> vSrgbPixels, vLinearPixels;
+    MipBuilder::Build(vSource.data(), 64, 64, true, vSrgbMips, vSrgbPixels, 1);
+    MipBuilder::Build(vSource.data(), 64, 64, false, vLinearMips, vLinearPixels, 1);
+
+    //half black half white is 0.5 in linear light, about 188 once encoded as srgb. Averaging the encoded values gives 128
+    const uint8_t* pSrgb = &vSrgbPixels[vSrgbMips.back().offset];
+    const uint8_t* pLinear = &vLinearPixels[vLinearMips.back().offset];
+    CHECK(std::abs(int(pSrgb[0]) - 188) <= 8);
+    CHECK(std::abs(int(pLinear[0]) - 128) <= 2);
+    CHECK(pSrgb[3] == 255);
+}
+
+TEST_CASE(MipBuilder_TransparentTexelsDoNotBleedColor)
+{
+    const std::vector<uint8_t> vSource = buildChecker(64, 64, true);
+    std::vector<TextureCacheMip> vMips;
+    std::vector<uint8_t> vPixels;
+    MipBuilder::Build(vSource.data(), 64, 64, true, vMips, vPixels, 1);
+
+    //color is weighted by alpha, so the invisible white does not lighten the black. Alpha itself is never srgb
+    const uint8_t* pLast = &vPixels[vMips.back().offset];
+    CHECK(pLast[0] <= 2);
+    CHECK(std::abs(int(pLast[3]) - 128) <= 2);
+}
+
+TEST_CASE(MipBuilder_ThreadCountDoesNotChangeTheResult)
+{
+    const std::vector<uint8_t> vSource = buildChecker(512, 300);
+    std::vector<TextureCacheMip> vMips;
+    std::vector<uint8_t> vSingle, vThreaded;
+    MipBuilder::Build(vSource.data(), 512, 300, true, vMips, vSingle, 1);
+    MipBuilder::Build(vSource.data(), 512, 300, true, vMips, vThreaded, 4);
+    CHECK(vSingle == vThreaded);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <string>
+
+//Minimal self registering test runner, so the Tests project needs nothing but the engine sources it tests
+//  TEST_CASE(Name) { CHECK(a == b); }
+//Run from the VulkanTutorial folder: Tests [name filter]
+class Test
+{
+public:
+    using Body = void(*)();
+
+    struct Registration
+    {
+        Registration(const char* name, Body body) { GetCases().push_back({ name, body }); }
+    };
+
+    //records a failure and keeps going, so one run shows every broken check
+    static void Check(bool condition, const char* expression, const char* file, int line);
+    //runs the cases with filter in their name, returns the amount off failed ones
+    static int Run(const std::string& filter);
+
+private:
+    struct Case
+    {
+        const char* name;
+        Body body;
+    };
+    static std::vector<Case>& GetCases();
+    static inline int s_CheckFailures{ 0 };
+};
+
+#define TEST_CASE(name) static void name(); static Test::Registration name##Registration{ #name, name }; static void name()
+#define CHECK(condition) Test::Check((condition), #condition, __FILE__, __LINE__)
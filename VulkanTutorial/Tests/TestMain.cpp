@@ -0,0 +1,48 @@
+#include "Test.h"
+#include <iostream>
+#include <exception>
+
+
+std::vector<Test::Case>& Test::GetCases()
+{
+    static std::vector<Case> vCases; //function local so registrations from other files can run first
+    return vCases;
+}
+
+void Test::Check(bool condition, const char* expression, const char* file, int line)
+{
+    if (condition)
+        return;
+    ++s_CheckFailures;
+    std::cout << "  " << file << "(" << line << "): CHECK(" << expression << ") failed\n";
+}
+
+int Test::Run(const std::string& filter)
+{
+    int failedCases{ 0 }, ranCases{ 0 };
+    for (const Case& testCase : GetCases())
+    {
+        if (std::string(testCase.name).find(filter) == std::string::npos)
+            continue;
+
+        ++ranCases;
+        const int failuresBefore = s_CheckFailures;
+        try {
+            testCase.body();
+        }
+        catch (const std::exception& e) {
+            ++s_CheckFailures;
+            std::cout << "  exception: " << e.what() << "\n";
+        }
+        const bool isPassed = s_CheckFailures == failuresBefore;
+        failedCases += isPassed ? 0 : 1;
+        std::cout << (isPassed ? "[pass] " : "[FAIL] ") << testCase.name << std::endl;
+    }
+    std::cout << ranCases - failedCases << "/" << ranCases << " passed\n";
+    return failedCases;
+}
+
+int main(int argc, char* argv[])
+{
+    return Test::Run(argc > 1 ? argv[1] : "") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+//Procedural meshes for the tests and benchmarks, there are no model files in the repo
+class TestMeshes
+{
+public:
+    //side x side quads in the xz plane, isBumpy adds a height field so simplifying it has a cost
+    //isShuffled randomizes the triangle order (the worst case for the vertex cache)
+    static void BuildGrid(uint32_t side, bool isBumpy, bool isShuffled, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices)
+    {
+        vertices.clear();
+        indices.clear();
+        for (uint32_t z{}; z <= side; ++z)
+            for (uint32_t x{}; x <= side; ++x)
+            {
+                Vertex3D vertex{};
+                const float height = isBumpy ? 0.1f * side * std::sin(x * 0.4f) * std::cos(z * 0.3f) : 0.0f;
+                vertex.pos = { float(x), height, float(z) };
+                vertex.normal = { 0.0f, 1.0f, 0.0f };
+                vertex.texcoord = { float(x) / side, float(z) / side };
+                vertices.push_back(vertex);
+            }
+
+        std::vector<std::array<uint32_t, 3>> vTriangles;
+        for (uint32_t z{}; z < side; ++z)
+            for (uint32_t x{}; x < side; ++x)
+            {
+                const uint32_t corner{ z * (side + 1) + x };
+                vTriangles.push_back({ corner, corner + side + 1, corner + 1 });
+                vTriangles.push_back({ corner + 1, corner + side + 1, corner + side + 2 });
+            }
+        if (isShuffled)
+            std::shuffle(vTriangles.begin(), vTriangles.end(), std::mt19937{ 7 });
+
+        for (const auto& triangle : vTriangles)
+            indices.insert(indices.end(), triangle.begin(), triangle.end());
+    }
+
+    //one vertex per triangle corner off a flat shuffled grid, which is what a parser hands the vertex dedup.
+    //Every inner vertex shows up 6 times and neighbouring corners are not neighbours in memory
+    static std::vector<Vertex3D> BuildShuffledGridCorners(uint32_t side)
+    {
+        std::vector<Vertex3D> vertices;
+        std::vector<uint32_t> indices;
+        BuildGrid(side, false, true, vertices, indices);
+
+        std::vector<Vertex3D> corners;
+        corners.reserve(indices.size());
+        for (uint32_t index : indices)
+            corners.push_back(vertices[index]);
+        return corners;
+    }
+
+    //every triangle as its vertices, rotated so the smallest index comes first (keeps the winding) and sorted,
+    //two index buffers with the same result draw the same surface
+    static std::vector<std::array<Vertex3D, 3>> GetTriangleSet(const std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices)
+    {
+        std::vector<std::array<uint32_t, 3>> vTriangles;
+        for (size_t i{}; i + 2 < indices.size(); i += 3)
+            vTriangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+
+        std::vector<std::array<Vertex3D, 3>> vResult;
+        for (auto& triangle : vTriangles)
+        {
+            std::array<Vertex3D, 3> corners{ vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]] };
+            const size_t first = std::min_element(corners.begin(), corners.end(), isLess) - corners.begin();
+            std::rotate(corners.begin(), corners.begin() + first, corners.end());
+            vResult.push_back(corners);
+        }
+        std::sort(vResult.begin(), vResult.end(), [](const auto& a, const auto& b)
+            { return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), isLess); });
+        return vResult;
+    }
+
+private:
+    static bool isLess(const Vertex3D& a, const Vertex3D& b)
+    {
+        const std::array<float, 8> left{ a.pos.x, a.pos.y, a.pos.z, a.normal.x, a.normal.y, a.normal.z, a.texcoord.x, a.texcoord.y };
+        const std::array<float, 8> right{ b.pos.x, b.pos.y, b.pos.z, b.normal.x, b.normal.y, b.normal.z, b.texcoord.x, b.texcoord.y };
+        return left < right;
+    }
+};
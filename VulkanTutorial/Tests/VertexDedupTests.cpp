@@ -0,0 +1,92 @@
+#include "Test.h"
+#include "TestMeshes.h"
+#include "VertexDedupTable.h"
+#include <algorithm>
+
+
+static void deduplicateSerial(const std::vector<Vertex3D>& corners, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices)
+{
+    VertexDedupTable uniqueVertices{ corners.size() };
+    for (const Vertex3D& corner : corners)
+        indices.push_back(uniqueVertices.Insert(corner, vertices));
+}
+
+
+TEST_CASE(VertexDedupTable_InsertMergesEqualVertices)
+{
+    const std::vector<Vertex3D> corners = TestMeshes::BuildShuffledGridCorners(20);
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    deduplicateSerial(corners, vertices, indices);
+
+    CHECK(vertices.size() == 21 * 21);
+    CHECK(indices.size() == corners.size());
+    bool isSameVertex{ true };
+    for (size_t corner{}; corner < corners.size(); ++corner)
+        isSameVertex = isSameVertex && vertices[indices[corner]] == corners[corner];
+    CHECK(isSameVertex);
+}
+
+TEST_CASE(VertexDedupTable_NegativeZeroMatchesZero)
+{
+    Vertex3D positive{}, negative{};
+    negative.pos = { -0.0f, 0.0f, -0.0f };
+    CHECK(VertexDedupTable::Hash(positive) == VertexDedupTable::Hash(negative));
+
+    std::vector<Vertex3D> vertices;
+    VertexDedupTable uniqueVertices{ 2 };
+    CHECK(uniqueVertices.Insert(positive, vertices) == uniqueVertices.Insert(negative, vertices));
+    CHECK(vertices.size() == 1);
+}
+
+TEST_CASE(VertexDedupTable_GrowsPastExpectedCount)
+{
+    const std::vector<Vertex3D> corners = TestMeshes::BuildShuffledGridCorners(10);
+    std::vector<Vertex3D> vertices;
+    VertexDedupTable uniqueVertices{ 1 };
+    bool isStable{ true };
+    for (const Vertex3D& corner : corners)
+    {
+        const uint32_t index = uniqueVertices.Insert(corner, vertices);
+        isStable = isStable && index < vertices.size() && vertices[index] == corner;
+    }
+    CHECK(isStable);
+    CHECK(vertices.size() == 11 * 11);
+}
+
+TEST_CASE(VertexDedupTable_ParallelMatchesSerialForAnyThreadCount)
+{
+    const std::vector<Vertex3D> corners = TestMeshes::BuildShuffledGridCorners(64);
+    std::vector<Vertex3D> vSerialVertices;
+    std::vector<uint32_t> vSerialIndices;
+    deduplicateSerial(corners, vSerialVertices, vSerialIndices);
+
+    for (unsigned int numThreads : { 0u, 1u, 2u, 3u, 4u, 7u, 16u })
+    {
+        std::vector<Vertex3D> vertices;
+        std::vector<uint32_t> indices;
+        VertexDedupTable::DeduplicateParallel(corners, numThreads, vertices, indices);
+        CHECK(vertices == vSerialVertices);
+        CHECK(indices == vSerialIndices);
+    }
+}
+
+TEST_CASE(VertexDedupTable_ParallelHandlesFewerCornersThanThreads)
+{
+    const std::vector<Vertex3D> corners = TestMeshes::BuildShuffledGridCorners(1);
+    std::vector<Vertex3D> vSerialVertices;
+    std::vector<uint32_t> vSerialIndices;
+    deduplicateSerial(corners, vSerialVertices, vSerialIndices);
+
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+    VertexDedupTable::DeduplicateParallel(corners, 16, vertices, indices);
+    CHECK(vertices == vSerialVertices);
+    CHECK(indices == vSerialIndices);
+
+    vertices.clear();
+    indices.clear();
+    VertexDedupTable::DeduplicateParallel({}, 4, vertices, indices);
+    CHECK(vertices.empty());
+    CHECK(indices.empty());
+}
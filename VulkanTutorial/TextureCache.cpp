@@ -0,0 +1,180 @@
+#include "TextureCache.h"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+
+bool TextureCache::Open(const std::string& texturePath)
+{
+    Close();
+
+    uint64_t sourceSize{};
+    uint64_t sourceHash{};
+    if (!getSourceKey(texturePath, sourceSize, sourceHash))
+        return false;
+
+    if (!m_File.Open(GetCachePath(texturePath)))
+        return false;
+
+    //validate everything before handing out pointers into the mapping
+    const size_t fileSize = m_File.GetSize();
+    if (fileSize < sizeof(TextureCacheHeader))
+    {
+        m_File.Close();
+        return false;
+    }
+
+    const TextureCacheHeader* pHeader = reinterpret_cast<const TextureCacheHeader*>(m_File.GetData());
+    const uint64_t mipBytes = uint64_t(pHeader->mipCount) * sizeof(TextureCacheMip);
+
+    bool isValid = pHeader->magic == Magic
+        && pHeader->version == Version
+        && GetMipBytes(static_cast<VkFormat>(pHeader->format), 1, 1) != 0
+        && pHeader->sourceSize == sourceSize
+        && pHeader->sourceHash == sourceHash
+        && pHeader->mipCount > 0
+        && pHeader->pathLength == texturePath.size()
+        && sizeof(TextureCacheHeader) + pHeader->pathLength <= fileSize
+        && pHeader->mipOffset % alignof(TextureCacheMip) == 0
+        && pHeader->pixelOffset % 16 == 0
+        && pHeader->mipOffset + mipBytes <= fileSize
+        && pHeader->pixelOffset + pHeader->pixelBytes <= fileSize;
+
+    if (isValid)
+        isValid = memcmp(m_File.GetData() + sizeof(TextureCacheHeader), texturePath.data(), texturePath.size()) == 0;
+
+    //every level has to stay inside the pixel section, hold all its texels/blocks and halve down from the top level
+    const TextureCacheMip* pMips = reinterpret_cast<const TextureCacheMip*>(m_File.GetData() + pHeader->mipOffset);
+    for (uint32_t mip{}; isValid && mip < pHeader->mipCount; ++mip)
+    {
+        isValid = pMips[mip].offset % 16 == 0
+            && pMips[mip].offset + pMips[mip].size <= pHeader->pixelBytes
+            && pMips[mip].size >= GetMipBytes(static_cast<VkFormat>(pHeader->format), pMips[mip].width, pMips[mip].height)
+            && pMips[mip].width == std::max(pHeader->width >> mip, 1u)
+            && pMips[mip].height == std::max(pHeader->height >> mip, 1u);
+    }
+
+    if (!isValid)
+    {
+        m_File.Close();
+        return false;
+    }
+
+    m_pHeader = pHeader;
+    return true;
+}
+
+void TextureCache::Close()
+{
+    m_File.Close();
+    m_pHeader = nullptr;
+}
+
+bool TextureCache::Write(const std::string& texturePath, VkFormat format,
+    const std::vector<TextureCacheMip>& mips, const std::vector<uint8_t>& pixels)
+{
+    if (mips.empty())
+        return false;
+
+    TextureCacheHeader header{};
+    if (!getSourceKey(texturePath, header.sourceSize, header.sourceHash))
+        return false;
+
+    header.magic       = Magic;
+    header.version     = Version;
+    header.format      = static_cast<uint32_t>(format);
+    header.width       = mips[0].width;
+    header.height      = mips[0].height;
+    header.mipCount    = static_cast<uint32_t>(mips.size());
+    header.pathLength  = static_cast<uint32_t>(texturePath.size());
+    header.mipOffset   = alignUp(sizeof(TextureCacheHeader) + header.pathLength, 16);
+    header.pixelOffset = alignUp(header.mipOffset + mips.size() * sizeof(TextureCacheMip), 16);
+    header.pixelBytes  = pixels.size();
+
+    //write next to the final file and swap it in, so a crash never leaves a half written cache behind
+    const std::string cachePath = GetCachePath(texturePath);
+    const std::string tempPath  = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        const char zeros[16]{};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(texturePath.data(), texturePath.size());
+        file.write(zeros, header.mipOffset - (sizeof(TextureCacheHeader) + header.pathLength));
+        file.write(reinterpret_cast<const char*>(mips.data()), mips.size() * sizeof(TextureCacheMip));
+        file.write(zeros, header.pixelOffset - (header.mipOffset + mips.size() * sizeof(TextureCacheMip)));
+        file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+uint64_t TextureCache::GetMipBytes(VkFormat format, uint32_t width, uint32_t height)
+{
+    const uint64_t blocks = uint64_t((width + 3) / 4) * ((height + 3) / 4);
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:     return uint64_t(width) * height * 4;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return blocks * 8;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:    return blocks * 16;
+    default:                           return 0;
+    }
+}
+
+const TextureCacheMip* TextureCache::GetMips()const
+{
+    return reinterpret_cast<const TextureCacheMip*>(m_File.GetData() + m_pHeader->mipOffset);
+}
+
+const uint8_t* TextureCache::GetPixels()const
+{
+    return m_File.GetData() + m_pHeader->pixelOffset;
+}
+
+bool TextureCache::getSourceKey(const std::string& texturePath, uint64_t& size, uint64_t& hash)
+{
+    //hashing the compressed source is a lot cheaper than decoding it and survives a fresh checkout (new write times)
+    MappedFile source;
+    if (!source.Open(texturePath))
+        return false;
+
+    size = source.GetSize();
+    const uint8_t* pData = source.GetData();
+
+    //fnv-1a over 8 byte words, the tail byte by byte
+    hash = 0xcbf29ce484222325ull;
+    const uint64_t prime = 0x100000001b3ull;
+    size_t index{ 0 };
+    for (; index + 8 <= source.GetSize(); index += 8)
+    {
+        uint64_t word;
+        memcpy(&word, pData + index, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; index < source.GetSize(); ++index)
+        hash = (hash ^ pData[index]) * prime;
+    return true;
+}
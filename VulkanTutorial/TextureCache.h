@@ -0,0 +1,66 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+//one level inside the pixel section, rows are tightly packed
+struct TextureCacheMip
+{
+    uint64_t offset; //from the start off the pixel section, 16 byte aligned so it works as a bufferOffset for any format
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+//Binary file layout (a stripped down KTX2: one 2D image, one layer, every mip level already built):
+//  TextureCacheHeader | source path (pathLength bytes) | mip table (mipOffset, mipCount) | pixels (pixelOffset, pixelBytes)
+struct TextureCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;      //VkFormat off the pixels, rgba8 or BC
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint64_t sourceSize;  //size and content hash off the image it was cooked from
+    uint64_t sourceHash;
+    uint32_t pathLength;
+    uint32_t padding;
+    uint64_t mipOffset;
+    uint64_t pixelOffset;
+    uint64_t pixelBytes;
+};
+
+//Decoded, mip complete texels off a texture, stored next to the source image so warm starts skip the decode
+//and the mip blits and copy every level straight out off the mapping. Open() memory maps the file, the data is only valid until Close()
+class TextureCache
+{
+public:
+    static constexpr uint32_t Magic{ 0x43544B56 }; //"VKTC"
+    static constexpr uint32_t Version{ 2 };
+
+    //any format GetMipBytes knows, the caller decides if it can use GetFormat()
+    bool Open(const std::string& texturePath);
+    void Close();
+    static bool Write(const std::string& texturePath, VkFormat format,
+        const std::vector<TextureCacheMip>& mips, const std::vector<uint8_t>& pixels);
+    static std::string GetCachePath(const std::string& texturePath) { return texturePath + ".texcache"; };
+    //bytes off one tightly packed level (whole 4x4 blocks for the BC formats), 0 for formats the cache does not know
+    static uint64_t GetMipBytes(VkFormat format, uint32_t width, uint32_t height);
+
+    const TextureCacheMip* GetMips()const;
+    const uint8_t* GetPixels()const;
+    uint32_t GetWidth()const { return m_pHeader->width; };
+    uint32_t GetHeight()const { return m_pHeader->height; };
+    VkFormat GetFormat()const { return static_cast<VkFormat>(m_pHeader->format); };
+    uint32_t GetMipCount()const { return m_pHeader->mipCount; };
+    uint64_t GetPixelBytes()const { return m_pHeader->pixelBytes; };
+
+private:
+    MappedFile m_File;
+    const TextureCacheHeader* m_pHeader{ nullptr };
+
+    static bool getSourceKey(const std::string& texturePath, uint64_t& size, uint64_t& hash);
+};
@@ -0,0 +1,243 @@
+#include "TextureCompressor.h"
+#include "ParallelChunks.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring> //stb_dxt needs memcpy/memset before it gets included
+#include <thread>
+#include <stdexcept>
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+
+//rgb565 to 8 bit per channel, the low bits repeat the high ones like the hardware does
+static void decodeColor565(uint16_t color, uint8_t* pRgb)
+{
+    const uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    pRgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    pRgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    pRgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+}
+
+//BC1 color block into the rgb off 16 rgba texels, alpha stays untouched (BC1_RGB decodes the 3 color mode's last entry as opaque black)
+static void decodeColorBlock(const uint8_t* pBlock, uint8_t* pTexels, bool isBc1)
+{
+    const uint16_t color0 = static_cast<uint16_t>(pBlock[0] | (pBlock[1] << 8));
+    const uint16_t color1 = static_cast<uint16_t>(pBlock[2] | (pBlock[3] << 8));
+    uint8_t palette[4][3]{};
+    decodeColor565(color0, palette[0]);
+    decodeColor565(color1, palette[1]);
+
+    //inside BC3 the color block always uses 4 colors
+    const bool isFourColor = !isBc1 || color0 > color1;
+    for (uint32_t channel{}; channel < 3; ++channel)
+    {
+        if (isFourColor)
+        {
+            palette[2][channel] = static_cast<uint8_t>((2 * palette[0][channel] + palette[1][channel] + 1) / 3);
+            palette[3][channel] = static_cast<uint8_t>((palette[0][channel] + 2 * palette[1][channel] + 1) / 3);
+        }
+        else
+        {
+            palette[2][channel] = static_cast<uint8_t>((palette[0][channel] + palette[1][channel] + 1) / 2);
+            palette[3][channel] = 0;
+        }
+    }
+
+    const uint32_t indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (uint32_t(pBlock[7]) << 24);
+    for (uint32_t texel{}; texel < 16; ++texel)
+        memcpy(pTexels + texel * 4, palette[(indices >> (texel * 2)) & 3], 3);
+}
+
+//BC4 block (BC3 alpha, BC5 red/green) into one channel off 16 rgba texels
+static void decodeChannelBlock(const uint8_t* pBlock, uint8_t* pTexels, uint32_t channel)
+{
+    uint32_t palette[8]{ pBlock[0], pBlock[1] };
+    if (palette[0] > palette[1])
+    {
+        for (uint32_t entry{ 1 }; entry < 7; ++entry)
+            palette[entry + 1] = ((7 - entry) * palette[0] + entry * palette[1] + 3) / 7;
+    }
+    else
+    {
+        for (uint32_t entry{ 1 }; entry < 5; ++entry)
+            palette[entry + 1] = ((5 - entry) * palette[0] + entry * palette[1] + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices{ 0 };
+    for (uint32_t byte{}; byte < 6; ++byte)
+        indices |= uint64_t(pBlock[2 + byte]) << (byte * 8);
+    for (uint32_t texel{}; texel < 16; ++texel)
+        pTexels[texel * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (texel * 3)) & 7]);
+}
+
+
+VkFormat TextureCompressor::SelectFormat(const uint8_t* pPixels, uint32_t width, uint32_t height, bool isSrgb, bool isTwoChannel)
+{
+    if (isTwoChannel)
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+
+    const uint64_t texelCount = uint64_t(width) * height;
+    for (uint64_t texel{}; texel < texelCount; ++texel)
+    {
+        if (pPixels[texel * 4 + 3] != 255)
+            return isSrgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+    return isSrgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+}
+
+bool TextureCompressor::IsCompressed(VkFormat format)
+{
+    return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        || format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC3_UNORM_BLOCK
+        || format == VK_FORMAT_BC5_UNORM_BLOCK;
+}
+
+CompressionStats TextureCompressor::Compress(VkFormat format, const std::vector<TextureCacheMip>& srcMips, const std::vector<uint8_t>& srcPixels,
+    std::vector<TextureCacheMip>& dstMips, std::vector<uint8_t>& dstPixels, unsigned int numThreads)
+{
+    if (!IsCompressed(format))
+        throw std::runtime_error("not a block compressed format");
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    const uint64_t blockBytes = TextureCache::GetMipBytes(format, 4, 4);
+
+    //same levels, block sized, and one work item per block row off every level so the small levels do not leave threads idle
+    struct BlockRow
+    {
+        uint32_t mip;
+        uint32_t row;
+    };
+    std::vector<BlockRow> vBlockRows;
+    CompressionStats stats{};
+    uint64_t texelCount{ 0 };
+    uint64_t offset{ 0 };
+    dstMips.resize(srcMips.size());
+    for (uint32_t mip{}; mip < srcMips.size(); ++mip)
+    {
+        TextureCacheMip& level = dstMips[mip];
+        level.width  = srcMips[mip].width;
+        level.height = srcMips[mip].height;
+        level.offset = offset;
+        level.size   = TextureCache::GetMipBytes(format, level.width, level.height);
+        offset = (offset + level.size + 15) / 16 * 16;
+
+        for (uint32_t row{}; row < (level.height + 3) / 4; ++row)
+            vBlockRows.push_back({ mip, row });
+        texelCount += uint64_t(level.width) * level.height;
+        stats.sourceBytes += srcMips[mip].size;
+    }
+    dstPixels.resize(static_cast<size_t>(offset));
+    stats.compressedBytes = offset;
+
+    ParallelChunks::Run(vBlockRows.size(), numThreads, [&](size_t begin, size_t end, unsigned int)
+        {
+            uint8_t block[16 * 4];
+            uint8_t channels[16 * 2];
+            for (size_t index{ begin }; index < end; ++index)
+            {
+                const TextureCacheMip& src = srcMips[vBlockRows[index].mip];
+                const TextureCacheMip& dst = dstMips[vBlockRows[index].mip];
+                const uint8_t* pSrc = srcPixels.data() + src.offset;
+                uint8_t* pDst = dstPixels.data() + dst.offset + uint64_t(vBlockRows[index].row) * ((dst.width + 3) / 4) * blockBytes;
+
+                for (uint32_t blockX{}; blockX < (dst.width + 3) / 4; ++blockX)
+                {
+                    //blocks past the right/bottom edge repeat the last texels, the sampler never reads them
+                    for (uint32_t texel{}; texel < 16; ++texel)
+                    {
+                        const uint32_t x = std::min(blockX * 4 + texel % 4, src.width - 1);
+                        const uint32_t y = std::min(vBlockRows[index].row * 4 + texel / 4, src.height - 1);
+                        memcpy(block + texel * 4, pSrc + (uint64_t(y) * src.width + x) * 4, 4);
+                    }
+
+                    uint8_t* pBlock = pDst + blockX * blockBytes;
+                    if (format == VK_FORMAT_BC5_UNORM_BLOCK)
+                    {
+                        for (uint32_t texel{}; texel < 16; ++texel)
+                        {
+                            channels[texel * 2]     = block[texel * 4];
+                            channels[texel * 2 + 1] = block[texel * 4 + 1];
+                        }
+                        stb_compress_bc5_block(pBlock, channels);
+                    }
+                    else
+                    {
+                        const int hasAlpha = blockBytes == 16 ? 1 : 0;
+                        stb_compress_dxt_block(pBlock, block, hasAlpha, STB_DXT_HIGHQUAL);
+                    }
+                }
+            }
+        });
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    stats.megapixelsPerSecond = texelCount / 1e6 / std::max(1e-9, std::chrono::duration<double>(endTime - startTime).count());
+
+    //quality off the top level, only over the channels the format stores
+    std::vector<uint8_t> vDecoded;
+    Decompress(format, dstPixels.data(), dstMips[0].width, dstMips[0].height, vDecoded);
+    const uint32_t channelCount = format == VK_FORMAT_BC5_UNORM_BLOCK ? 2 : (blockBytes == 16 ? 4 : 3);
+    stats.psnr = CalculatePsnr(srcPixels.data() + srcMips[0].offset, vDecoded.data(), uint64_t(dstMips[0].width) * dstMips[0].height, channelCount);
+    return stats;
+}
+
+void TextureCompressor::Decompress(VkFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, std::vector<uint8_t>& pixels)
+{
+    const uint64_t blockBytes = TextureCache::GetMipBytes(format, 4, 4);
+    const uint32_t blocksWide = (width + 3) / 4;
+    pixels.assign(size_t(width) * height * 4, 255);
+
+    uint8_t texels[16 * 4];
+    for (uint32_t blockY{}; blockY < (height + 3) / 4; ++blockY)
+    {
+        for (uint32_t blockX{}; blockX < blocksWide; ++blockX)
+        {
+            const uint8_t* pBlock = pBlocks + (uint64_t(blockY) * blocksWide + blockX) * blockBytes;
+            memset(texels, 255, sizeof(texels));
+            if (format == VK_FORMAT_BC5_UNORM_BLOCK)
+            {
+                decodeChannelBlock(pBlock, texels, 0);
+                decodeChannelBlock(pBlock + 8, texels, 1);
+                for (uint32_t texel{}; texel < 16; ++texel)
+                    texels[texel * 4 + 2] = 0;
+            }
+            else if (blockBytes == 16)
+            {
+                decodeChannelBlock(pBlock, texels, 3);
+                decodeColorBlock(pBlock + 8, texels, false);
+            }
+            else
+                decodeColorBlock(pBlock, texels, true);
+
+            for (uint32_t texel{}; texel < 16; ++texel)
+            {
+                const uint32_t x = blockX * 4 + texel % 4;
+                const uint32_t y = blockY * 4 + texel / 4;
+                if (x < width && y < height)
+                    memcpy(pixels.data() + (uint64_t(y) * width + x) * 4, texels + texel * 4, 4);
+            }
+        }
+    }
+}
+
+double TextureCompressor::CalculatePsnr(const uint8_t* pReference, const uint8_t* pPixels, uint64_t texelCount, uint32_t channelCount)
+{
+    double squaredError{ 0.0 };
+    for (uint64_t texel{}; texel < texelCount; ++texel)
+    {
+        for (uint32_t channel{}; channel < channelCount; ++channel)
+        {
+            const double difference = double(pReference[texel * 4 + channel]) - double(pPixels[texel * 4 + channel]);
+            squaredError += difference * difference;
+        }
+    }
+
+    const double meanSquaredError = squaredError / std::max<double>(1.0, double(texelCount) * channelCount);
+    if (meanSquaredError == 0.0)
+        return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
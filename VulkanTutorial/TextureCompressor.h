@@ -0,0 +1,34 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "TextureCache.h"
+#include <vector>
+#include <cstdint>
+
+//what a compress run cost and how close the blocks are to the source (mip 0, decoded back)
+struct CompressionStats
+{
+    uint64_t sourceBytes{ 0 };
+    uint64_t compressedBytes{ 0 };
+    double psnr{ 0.0 };             //dB over the channels the format keeps, higher is better (~35+ looks clean)
+    double megapixelsPerSecond{ 0.0 };
+};
+
+//Import time block compression off whole mip chains with stb_dxt (BC1/BC3/BC5), the blocks off all levels are split across threads
+//The compressed levels keep the TextureCacheMip layout so they cook and upload exactly like rgba8 ones
+class TextureCompressor
+{
+public:
+    //BC1 when every texel is opaque, BC3 otherwise. isTwoChannel (normal maps, only red and green matter) picks BC5
+    static VkFormat SelectFormat(const uint8_t* pPixels, uint32_t width, uint32_t height, bool isSrgb, bool isTwoChannel = false);
+    static bool IsCompressed(VkFormat format);
+
+    //srcMips/srcPixels as MipBuilder makes them (rgba8), every level gets compressed. numThreads = 0 uses all hardware threads
+    static CompressionStats Compress(VkFormat format, const std::vector<TextureCacheMip>& srcMips, const std::vector<uint8_t>& srcPixels,
+        std::vector<TextureCacheMip>& dstMips, std::vector<uint8_t>& dstPixels, unsigned int numThreads = 0);
+
+    //decodes the blocks off one level back to rgba8 (what the sampler would see, up to rounding)
+    static void Decompress(VkFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, std::vector<uint8_t>& pixels);
+    //peak signal to noise ratio off two rgba8 images over the first channelCount channels
+    static double CalculatePsnr(const uint8_t* pReference, const uint8_t* pPixels, uint64_t texelCount, uint32_t channelCount);
+};
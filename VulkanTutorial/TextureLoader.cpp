@@ -0,0 +1,126 @@
+#include "TextureLoader.h"
+#include "LoaderPool.h"
+#include "MipBuilder.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <stdexcept>
+
+
+void DecodedPixelsDeleter::operator()(uint8_t* pPixels)const
+{
+    stbi_image_free(pPixels);
+}
+
+TextureLoader::TextureLoader(LoaderPool& loaderPool, const TextureLoadSettings& settings)
+    : m_LoaderPool{ loaderPool }, m_Settings{ settings }
+{
+}
+
+std::vector<std::future<void>> TextureLoader::Load(const std::vector<std::string>& vPaths, std::vector<LoadedTexture>& vTextures)
+{
+    vTextures.clear();
+    vTextures.resize(vPaths.size());
+
+    //the textures already keep the pool busy, a single one gets every thread for its mips and blocks
+    const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency() / static_cast<unsigned int>(std::max<size_t>(1, vPaths.size())));
+
+    std::vector<std::future<void>> vFutures;
+    vFutures.reserve(vPaths.size());
+    for (size_t i{}; i < vPaths.size(); ++i)
+    {
+        LoadedTexture* pTexture = &vTextures[i];
+        pTexture->path = vPaths[i];
+        const TextureLoadSettings settings = m_Settings;
+        vFutures.push_back(m_LoaderPool.Submit([pTexture, settings, numThreads]() { load(*pTexture, settings, numThreads); }));
+    }
+    return vFutures;
+}
+
+std::future<void> TextureLoader::Fill(const LoadedTexture& texture, const StagingRegion& region)
+{
+    if (region.size < texture.GetPixelBytes())
+        throw std::runtime_error("staging region too small for " + texture.path);
+
+    const LoadedTexture* pTexture = &texture;
+    void* pData = region.pData;
+    return m_LoaderPool.Submit([pTexture, pData]() { memcpy(pData, pTexture->GetPixels(), static_cast<size_t>(pTexture->GetPixelBytes())); });
+}
+
+void TextureLoader::load(LoadedTexture& texture, const TextureLoadSettings& settings, unsigned int numThreads)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    texture.isBlitMipmapped = settings.isBlitMipmapped;
+    const bool isNormal = isNormalMap(texture.path);
+    const bool isBc5 = isNormal && settings.isCompressing && settings.isCompressingNormals;
+    const VkFormat uncompressedFormat = isNormal ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+
+    //warm start maps the cooked mip chain, a cache cooked with other settings gets recooked
+    if (!settings.isBlitMipmapped)
+    {
+        auto pCache = std::make_unique<TextureCache>();
+        const bool isUsable = pCache->Open(texture.path)
+            && (settings.isCompressing ? TextureCompressor::IsCompressed(pCache->GetFormat()) && isBc5 == (pCache->GetFormat() == VK_FORMAT_BC5_UNORM_BLOCK)
+                                       : pCache->GetFormat() == uncompressedFormat);
+        if (isUsable)
+        {
+            texture.format = pCache->GetFormat();
+            texture.vMips.assign(pCache->GetMips(), pCache->GetMips() + pCache->GetMipCount());
+            texture.pCache = std::move(pCache);
+            texture.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+            return;
+        }
+    }
+
+    //cold start decodes, builds the mips on the cpu and cooks them for the next run
+    int texWidth{}, textHeight{}, textChannels{};
+    std::unique_ptr<uint8_t, DecodedPixelsDeleter> pPixels{ stbi_load(texture.path.c_str(), &texWidth, &textHeight, &textChannels, STBI_rgb_alpha) };
+    if (!pPixels)
+        throw std::runtime_error{ "failed to load texture image " + texture.path };
+
+    const uint32_t width = static_cast<uint32_t>(texWidth);
+    const uint32_t height = static_cast<uint32_t>(textHeight);
+    texture.format = uncompressedFormat;
+    if (settings.isBlitMipmapped)
+    {
+        texture.vMips = { { 0, uint64_t(width) * height * 4, width, height } };
+        texture.pDecodedPixels = std::move(pPixels);
+        texture.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+        return;
+    }
+
+    MipBuilder::Build(pPixels.get(), width, height, !isNormal, texture.vMips, texture.vPixels, numThreads);
+    if (settings.isCompressing)
+        texture.format = TextureCompressor::SelectFormat(pPixels.get(), width, height, !isNormal, isBc5);
+    pPixels.reset();
+
+    if (settings.isCompressing)
+    {
+        std::vector<TextureCacheMip> vBlockMips;
+        std::vector<uint8_t> vBlockPixels;
+        texture.compressionStats = TextureCompressor::Compress(texture.format, texture.vMips, texture.vPixels, vBlockMips, vBlockPixels, numThreads);
+        texture.vMips.swap(vBlockMips);
+        texture.vPixels.swap(vBlockPixels);
+    }
+
+    //a failed write only costs the next start the decode again
+    texture.isCacheWritten = TextureCache::Write(texture.path, texture.format, texture.vMips, texture.vPixels);
+    texture.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+bool TextureLoader::isNormalMap(const std::string& path)
+{
+    const size_t nameBegin = path.find_last_of("/\\") + 1;
+    std::string name = path.substr(nameBegin, path.find_last_of('.') - nameBegin);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char character) { return static_cast<char>(std::tolower(character)); });
+
+    for (const std::string& suffix : { std::string("_normal"), std::string("_nrm") })
+    {
+        if (name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "TextureCache.h"
+#include "TextureCompressor.h"
+#include "StagingRing.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+
+class LoaderPool;
+
+//what the workers need to know, decided on the render thread (format support is a vulkan query)
+struct TextureLoadSettings
+{
+    bool isCompressing{ false };   //cook BC blocks, the device samples BC1/BC3. Otherwise rgba8 (srgb, unorm for normal maps)
+    bool isCompressingNormals{ false }; //normal maps go to BC5 (the device samples it), otherwise they are compressed like colors
+    bool isBlitMipmapped{ false }; //only mip 0 gets decoded, the gpu blits the rest (rgba8, nothing gets cooked)
+};
+
+//frees what stbi_load returned, so the header does not need stb
+struct DecodedPixelsDeleter
+{
+    void operator()(uint8_t* pPixels)const;
+};
+
+//cpu side off one texture. The levels sit in the mapped cache on a warm start, in the cooked buffer otherwise.
+//Blit mipmapped textures cook nothing, they keep stbi_load's buffer and Fill copies straight out off it
+struct LoadedTexture
+{
+    std::string path;
+    VkFormat format{ VK_FORMAT_R8G8B8A8_SRGB };
+    std::vector<TextureCacheMip> vMips;
+    std::vector<uint8_t> vPixels;
+    std::unique_ptr<TextureCache> pCache;
+    std::unique_ptr<uint8_t, DecodedPixelsDeleter> pDecodedPixels;
+    bool isBlitMipmapped{ false };
+    CompressionStats compressionStats; //zero unless it got compressed this run
+    bool isCacheWritten{ false };      //cooked this run and stored for the next one
+    float milliseconds{ 0.f };         //worker time for this texture
+
+    bool IsCached()const { return pCache != nullptr; };
+    uint32_t GetMipCount()const { return static_cast<uint32_t>(vMips.size()); };
+    const uint8_t* GetPixels()const { return IsCached() ? pCache->GetPixels() : pDecodedPixels ? pDecodedPixels.get() : vPixels.data(); };
+    uint64_t GetPixelBytes()const { return IsCached() ? pCache->GetPixelBytes() : pDecodedPixels ? vMips[0].size : vPixels.size(); };
+};
+
+//Decodes, mips, compresses and cooks many textures at once on the LoaderPool (one job per texture),
+//then the levels get copied by the workers straight into persistently mapped staging memory.
+//Warm starts never touch a heap buffer, the mapped cache goes right into the staging region.
+//No vulkan calls, the render thread allocates the staging regions and records the copies into one upload batch
+class TextureLoader
+{
+public:
+    TextureLoader(LoaderPool& loaderPool, const TextureLoadSettings& settings);
+
+    //starts a job per path, vTextures gets one entry per path. The futures finish in roughly path order,
+    //an entry is only valid once its future did (get() rethrows a failed load)
+    std::vector<std::future<void>> Load(const std::vector<std::string>& vPaths, std::vector<LoadedTexture>& vTextures);
+    //copies every level into region.pData on the pool (GetPixelBytes bytes, same offsets as vMips).
+    //Wait on it before the batch that reads the region gets submitted, texture has to stay alive until then
+    std::future<void> Fill(const LoadedTexture& texture, const StagingRegion& region);
+
+private:
+    LoaderPool& m_LoaderPool;
+    TextureLoadSettings m_Settings;
+
+    //numThreads is what the mips and the compression off this one texture may use
+    static void load(LoadedTexture& texture, const TextureLoadSettings& settings, unsigned int numThreads);
+    //normal maps are found by name (..._normal.png, ..._nrm.png), they hold vectors so they stay linear
+    static bool isNormalMap(const std::string& path);
+};
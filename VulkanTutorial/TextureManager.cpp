@@ -0,0 +1,134 @@
+#include "TextureManager.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+TextureManager::TextureManager(VkPhysicalDevice physicalDevice, VkDevice logicDevice, DeviceAllocator& allocator, VkSampler sampler, uint32_t maxTextures)
+    : m_LogicalDevice{ logicDevice }, m_Allocator{ allocator }, m_Sampler{ sampler }
+{
+    //update after bind descriptors have their own (often lower) limits
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    m_Capacity = std::min({ maxTextures,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+    VkDescriptorSetLayoutBinding textureBinding{};
+    textureBinding.binding            = 0;
+    textureBinding.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    textureBinding.descriptorCount    = m_Capacity;
+    textureBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
+    textureBinding.pImmutableSamplers = nullptr;
+
+    //slots past the last texture stay empty, the shaders never index them
+    const VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+    bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount  = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext        = &bindingFlagsInfo;
+    layoutInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings    = &textureBinding;
+    if (vkCreateDescriptorSetLayout(m_LogicalDevice, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture descriptor set layout");
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = m_Capacity;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets       = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes    = &poolSize;
+    if (vkCreateDescriptorPool(m_LogicalDevice, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture descriptor pool");
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &m_DescriptorSetLayout;
+    if (vkAllocateDescriptorSets(m_LogicalDevice, &allocInfo, &m_DescriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate texture descriptor set");
+}
+
+TextureManager::~TextureManager()
+{
+    for (Texture& texture : m_vTextures)
+    {
+        vkDestroyImageView(m_LogicalDevice, texture.view, nullptr);
+        m_Allocator.DestroyImage(texture.image, texture.allocation);
+    }
+    vkDestroyDescriptorPool(m_LogicalDevice, m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_LogicalDevice, m_DescriptorSetLayout, nullptr);
+}
+
+bool TextureManager::Find(const std::string& texturePath, uint32_t& index)const
+{
+    auto it = m_Slots.find(texturePath);
+    if (it == m_Slots.end())
+        return false;
+    index = it->second;
+    return true;
+}
+
+uint32_t TextureManager::Add(const std::string& texturePath, VkImage image, const DeviceAllocation& allocation, VkFormat format, uint32_t mipCount)
+{
+    if (m_vTextures.size() >= m_Capacity)
+        throw std::runtime_error("texture array is full");
+
+    Texture texture{};
+    texture.image      = image;
+    texture.allocation = allocation;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = image;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = format;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = mipCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+    if (vkCreateImageView(m_LogicalDevice, &viewInfo, nullptr, &texture.view) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture image view");
+
+    const uint32_t index = static_cast<uint32_t>(m_vTextures.size());
+    m_vTextures.push_back(texture);
+    m_Slots[texturePath] = index;
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView   = texture.view;
+    imageInfo.sampler     = m_Sampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet          = m_DescriptorSet;
+    descriptorWrite.dstBinding      = 0;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo      = &imageInfo;
+    vkUpdateDescriptorSets(m_LogicalDevice, 1, &descriptorWrite, 0, nullptr);
+    return index;
+}
+
+void TextureManager::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)const
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+        DescriptorSet, 1, &m_DescriptorSet, 0, nullptr);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "DeviceAllocator.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Every sampled texture off the scene in one big descriptor array (VK_EXT_descriptor_indexing), bound once per command buffer.
+//Draws pick their texture with the index in ObjectUniformData, so objects with different textures never rebind a set.
+//The array is partially bound and update after bind, new textures get written while frames that use older slots are in flight
+class TextureManager
+{
+public:
+    //the set number the shaders use for the array (set 0 is the per frame set)
+    static constexpr uint32_t DescriptorSet{ 1 };
+    //slot 0, what draws without a texture sample (1x1 white, uploaded by the owner)
+    static constexpr uint32_t DefaultTexture{ 0 };
+
+    //maxTextures gets clamped to what the device allows for update after bind samplers
+    TextureManager(VkPhysicalDevice physicalDevice, VkDevice logicDevice, DeviceAllocator& allocator, VkSampler sampler, uint32_t maxTextures = m_DefaultMaxTextures);
+    //destroys the views and images, the gpu has to be done with them
+    ~TextureManager();
+
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    //false when nothing got added under that path yet
+    bool Find(const std::string& texturePath, uint32_t& index)const;
+    //takes over the image (already in SHADER_READ_ONLY_OPTIMAL once its upload completes), makes a view and writes the next slot
+    uint32_t Add(const std::string& texturePath, VkImage image, const DeviceAllocation& allocation, VkFormat format, uint32_t mipCount);
+
+    //set DescriptorSet off every pipeline layout built with GetDescriptorSetLayout
+    void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)const;
+
+    VkDescriptorSetLayout GetDescriptorSetLayout()const { return m_DescriptorSetLayout; };
+    uint32_t GetTextureCount()const { return static_cast<uint32_t>(m_vTextures.size()); };
+    uint32_t GetCapacity()const { return m_Capacity; };
+
+private:
+    struct Texture
+    {
+        VkImage image{ VK_NULL_HANDLE };
+        DeviceAllocation allocation;
+        VkImageView view{ VK_NULL_HANDLE };
+    };
+
+    static constexpr uint32_t m_DefaultMaxTextures{ 1024 };
+
+    VkDevice m_LogicalDevice;
+    DeviceAllocator& m_Allocator;
+    VkSampler m_Sampler;
+    uint32_t m_Capacity;
+    VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+    VkDescriptorPool m_DescriptorPool{ VK_NULL_HANDLE };
+    VkDescriptorSet m_DescriptorSet{ VK_NULL_HANDLE };
+    std::vector<Texture> m_vTextures; //index is the slot
+    std::unordered_map<std::string, uint32_t> m_Slots;
+};
@@ -0,0 +1,251 @@
+#include "UploadBatch.h"
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+
+
+UploadBatch::UploadBatch(VkDevice logicDevice, const UploadQueues& queues, StagingRing& stagingRing)
+    : m_LogicalDevice{ logicDevice }, m_Queues{ queues }, m_StagingRing{ stagingRing }
+{
+}
+
+UploadBatch::~UploadBatch()
+{
+    Wait();
+    if (m_TransferCommandBuffer != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(m_LogicalDevice, m_Queues.transferCommandPool, 1, &m_TransferCommandBuffer);
+    if (m_GraphicsCommandBuffer != VK_NULL_HANDLE && m_GraphicsCommandBuffer != m_TransferCommandBuffer)
+        vkFreeCommandBuffers(m_LogicalDevice, m_Queues.graphicsCommandPool, 1, &m_GraphicsCommandBuffer);
+    if (m_GraphicsFence != VK_NULL_HANDLE)
+        vkDestroyFence(m_LogicalDevice, m_GraphicsFence, nullptr);
+}
+
+VkCommandBuffer UploadBatch::GetTransferCommandBuffer()
+{
+    if (m_TransferCommandBuffer == VK_NULL_HANDLE)
+    {
+        if (!m_Queues.HasDedicatedTransfer())
+            m_TransferCommandBuffer = GetGraphicsCommandBuffer();
+        else
+            m_TransferCommandBuffer = beginCommandBuffer(m_Queues.transferCommandPool);
+    }
+    return m_TransferCommandBuffer;
+}
+
+VkCommandBuffer UploadBatch::GetGraphicsCommandBuffer()
+{
+    if (m_GraphicsCommandBuffer == VK_NULL_HANDLE)
+    {
+        if (!m_Queues.HasDedicatedTransfer() && m_TransferCommandBuffer != VK_NULL_HANDLE)
+            m_GraphicsCommandBuffer = m_TransferCommandBuffer;
+        else
+            m_GraphicsCommandBuffer = beginCommandBuffer(m_Queues.graphicsCommandPool);
+    }
+    return m_GraphicsCommandBuffer;
+}
+
+StagingRegion UploadBatch::Stage(const void* pData, VkDeviceSize size, VkDeviceSize alignment)
+{
+    StagingRegion region = Allocate(size, alignment);
+    memcpy(region.pData, pData, static_cast<size_t>(size));
+    return region;
+}
+
+StagingRegion UploadBatch::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    return m_StagingRing.Allocate(size, alignment);
+}
+
+void UploadBatch::CopyBuffer(const StagingRegion& src, VkBuffer dstBuffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, VkDeviceSize dstOffset)
+{
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = src.offset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size      = src.size;
+    vkCmdCopyBuffer(GetTransferCommandBuffer(), src.buffer, dstBuffer, 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = dstBuffer;
+    barrier.offset              = dstOffset;
+    barrier.size                = src.size;
+
+    if (!m_Queues.HasDedicatedTransfer())
+    {
+        vkCmdPipelineBarrier(GetTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+        return;
+    }
+
+    //release on the transfer queue, the matching acquire on the graphics queue (same barrier, both sides)
+    barrier.srcQueueFamilyIndex = m_Queues.transferFamily;
+    barrier.dstQueueFamilyIndex = m_Queues.graphicsFamily;
+    barrier.dstAccessMask       = 0;
+    vkCmdPipelineBarrier(GetTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+        0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(GetGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0,
+        0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadBatch::CopyBufferToImage(const StagingRegion& src, VkImage image, uint32_t width, uint32_t height)
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset      = src.offset;
+    region.bufferRowLength   = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+
+    region.imageOffset = { 0,0,0 };
+    region.imageExtent = { width, height, 1 };
+
+    vkCmdCopyBufferToImage(GetTransferCommandBuffer(), src.buffer, image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void UploadBatch::CopyBufferToImage(const StagingRegion& src, VkImage image, const VkBufferImageCopy* pRegions, uint32_t regionCount)
+{
+    std::vector<VkBufferImageCopy> vRegions(pRegions, pRegions + regionCount);
+    for (VkBufferImageCopy& region : vRegions)
+        region.bufferOffset += src.offset;
+
+    vkCmdCopyBufferToImage(GetTransferCommandBuffer(), src.buffer, image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, vRegions.data());
+}
+
+void UploadBatch::HandImageToGraphics(VkImage image, VkImageLayout layout, uint32_t mipLevels, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    HandImageToGraphics(image, layout, layout, mipLevels, dstStage, dstAccess);
+}
+
+void UploadBatch::HandImageToGraphics(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout                       = oldLayout;
+    barrier.newLayout                       = newLayout;
+    barrier.srcAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask                   = dstAccess;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+
+    if (!m_Queues.HasDedicatedTransfer())
+    {
+        vkCmdPipelineBarrier(GetTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+        return;
+    }
+
+    barrier.srcQueueFamilyIndex = m_Queues.transferFamily;
+    barrier.dstQueueFamilyIndex = m_Queues.graphicsFamily;
+    barrier.dstAccessMask       = 0;
+    vkCmdPipelineBarrier(GetTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(GetGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadBatch::Submit()
+{
+    if (IsSubmitted())
+        throw std::runtime_error("upload batch was already submitted");
+
+    const bool hasTransferWork = m_Queues.HasDedicatedTransfer() && m_TransferCommandBuffer != VK_NULL_HANDLE;
+    if (hasTransferWork)
+    {
+        //the staging regions are only read on the transfer queue, so the ring ticket goes there
+        vkEndCommandBuffer(m_TransferCommandBuffer);
+        m_Ticket = m_StagingRing.Submit(m_Queues.transferQueue, m_TransferCommandBuffer);
+        m_IsGraphicsPending = m_GraphicsCommandBuffer != VK_NULL_HANDLE;
+        return;
+    }
+
+    VkCommandBuffer commandBuffer = GetGraphicsCommandBuffer(); //an empty batch still gets a ticket
+    vkEndCommandBuffer(commandBuffer);
+    m_Ticket = m_StagingRing.Submit(m_Queues.graphicsQueue, commandBuffer);
+}
+
+bool UploadBatch::IsComplete()
+{
+    if (!IsSubmitted() || !m_StagingRing.IsComplete(m_Ticket))
+        return false;
+
+    if (m_IsGraphicsPending)
+        submitGraphics();
+    return m_GraphicsFence == VK_NULL_HANDLE || vkGetFenceStatus(m_LogicalDevice, m_GraphicsFence) == VK_SUCCESS;
+}
+
+void UploadBatch::Wait()
+{
+    if (!IsSubmitted())
+        return;
+
+    m_StagingRing.Wait(m_Ticket);
+    if (m_IsGraphicsPending)
+        submitGraphics();
+    if (m_GraphicsFence != VK_NULL_HANDLE)
+        vkWaitForFences(m_LogicalDevice, 1, &m_GraphicsFence, VK_TRUE, UINT64_MAX);
+}
+
+VkCommandBuffer UploadBatch::beginCommandBuffer(VkCommandPool commandPool)
+{
+    if (IsSubmitted())
+        throw std::runtime_error("upload batch was already submitted");
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool        = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(m_LogicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate upload command buffer");
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    return commandBuffer;
+}
+
+void UploadBatch::submitGraphics()
+{
+    //the transfer fence was seen signaled on the host, that orders the releases before these acquires without a semaphore
+    //and keeps the graphics queue from stalling on a copy that is still running
+    m_IsGraphicsPending = false;
+    vkEndCommandBuffer(m_GraphicsCommandBuffer);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(m_LogicalDevice, &fenceInfo, nullptr, &m_GraphicsFence) != VK_SUCCESS)
+        throw std::runtime_error("failed to create upload fence");
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &m_GraphicsCommandBuffer;
+
+    if (vkQueueSubmit(m_Queues.graphicsQueue, 1, &submitInfo, m_GraphicsFence) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit upload command buffer");
+}
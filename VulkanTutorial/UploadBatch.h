@@ -0,0 +1,77 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "StagingRing.h"
+#include <cstdint>
+
+//where uploads run, without a transfer only queue family the transfer fields are copies off the graphics ones
+struct UploadQueues
+{
+    VkQueue graphicsQueue{ VK_NULL_HANDLE };
+    VkCommandPool graphicsCommandPool{ VK_NULL_HANDLE };
+    uint32_t graphicsFamily{ 0 };
+    VkQueue transferQueue{ VK_NULL_HANDLE };
+    VkCommandPool transferCommandPool{ VK_NULL_HANDLE };
+    uint32_t transferFamily{ 0 };
+
+    bool HasDedicatedTransfer()const { return transferFamily != graphicsFamily; };
+};
+
+//Records any number off uploads (copies, layout transitions, mip blits) into one command buffer per queue
+//that go out in a single submit each. Nothing waits on a queue, the owner polls IsComplete
+//or calls Wait only when it needs the data on the gpu, the staging memory or the command buffers back.
+//With a dedicated transfer queue the copies run there next to the rendering, the resources get released to the graphics family
+//and the graphics side (acquire barriers, mip blits) is only submitted once the copies are done, so frames never wait on it.
+//Stage only into the batch that gets submitted next, the ring hands the regions to whatever submits first
+class UploadBatch
+{
+public:
+    UploadBatch(VkDevice logicDevice, const UploadQueues& queues, StagingRing& stagingRing);
+    //waits for a submitted batch that is not done yet, the command buffers can not be freed before
+    ~UploadBatch();
+
+    UploadBatch(const UploadBatch&) = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+
+    //copies and transfer stage barriers, starts recording on first use
+    VkCommandBuffer GetTransferCommandBuffer();
+    //everything that needs a graphics queue (blits, depth layouts), recorded after the transfer side in execution order
+    VkCommandBuffer GetGraphicsCommandBuffer();
+    //copies the data into the staging ring
+    StagingRegion Stage(const void* pData, VkDeviceSize size, VkDeviceSize alignment = 16);
+    //room in the staging ring to write into directly (pData, any thread), same rules as Stage.
+    //The writes have to be done before this batch gets submitted
+    StagingRegion Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    //the buffer is usable by dstStage/dstAccess on the graphics queue once the batch completed
+    void CopyBuffer(const StagingRegion& src, VkBuffer dstBuffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, VkDeviceSize dstOffset = 0);
+    //tightly packed texels into mip 0, the image has to be in TRANSFER_DST_OPTIMAL
+    void CopyBufferToImage(const StagingRegion& src, VkImage image, uint32_t width, uint32_t height);
+    //any number off levels in one copy, the bufferOffsets are relative to src
+    void CopyBufferToImage(const StagingRegion& src, VkImage image, const VkBufferImageCopy* pRegions, uint32_t regionCount);
+    //makes the transfer writes visible to the graphics side (ownership transfer when the queues differ)
+    void HandImageToGraphics(VkImage image, VkImageLayout layout, uint32_t mipLevels, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+    //same, the layout goes from oldLayout to newLayout on the way (both halves off the ownership transfer carry it)
+    void HandImageToGraphics(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    //nothing got recorded, submitting would be a wasted round trip
+    bool IsEmpty()const { return m_TransferCommandBuffer == VK_NULL_HANDLE && m_GraphicsCommandBuffer == VK_NULL_HANDLE; };
+    void Submit();
+    bool IsSubmitted()const { return m_Ticket != 0; };
+    //false until submitted, never blocks. Submits the graphics side once the transfer side finished
+    bool IsComplete();
+    //returns right away when not submitted
+    void Wait();
+
+private:
+    VkDevice m_LogicalDevice;
+    UploadQueues m_Queues;
+    StagingRing& m_StagingRing;
+    VkCommandBuffer m_TransferCommandBuffer{ VK_NULL_HANDLE };
+    VkCommandBuffer m_GraphicsCommandBuffer{ VK_NULL_HANDLE }; //the same one without a dedicated transfer queue
+    uint64_t m_Ticket{ 0 };                  //staging ring submission off the first command buffer
+    VkFence m_GraphicsFence{ VK_NULL_HANDLE }; //graphics side after a dedicated transfer, the ring does not track it
+    bool m_IsGraphicsPending{ false };
+
+    VkCommandBuffer beginCommandBuffer(VkCommandPool commandPool);
+    void submitGraphics();
+};
@@ -0,0 +1,230 @@
+#include "VertexDedupTable.h"
+#include "ParallelChunks.h"
+#include <cstring>
+#include <algorithm>
+
+
+//finalizer off murmur3, every input bit affects every output bit
+static inline uint64_t mix64(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static inline uint32_t floatBits(float value)
+{
+    if (value == 0.0f)
+        value = 0.0f; //-0.0 == 0.0 so they have to end up in the same slot
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline uint64_t packPair(float low, float high)
+{
+    return uint64_t(floatBits(low)) | (uint64_t(floatBits(high)) << 32);
+}
+
+static size_t nextPowerOfTwo(size_t value)
+{
+    size_t result{ 16 };
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+VertexDedupTable::VertexDedupTable(size_t expectedVertices)
+{
+    //keep the load factor under 3/4 without ever growing
+    const size_t capacity = nextPowerOfTwo(expectedVertices + expectedVertices / 3 + 1);
+    m_vSlots.assign(capacity, Slot{ 0, EmptySlot });
+    m_Mask = capacity - 1;
+}
+
+uint32_t VertexDedupTable::Insert(const Vertex3D& vertex, std::vector<Vertex3D>& vertices)
+{
+    if ((m_Count + 1) * 4 > m_vSlots.size() * 3)
+        grow(vertices);
+
+    const uint64_t hash = Hash(vertex);
+    const uint32_t tag  = static_cast<uint32_t>(hash >> 32);
+
+    size_t slotIndex = static_cast<size_t>(hash) & m_Mask;
+    while (true)
+    {
+        Slot& slot = m_vSlots[slotIndex];
+        if (slot.index == EmptySlot)
+        {
+            slot.tag   = tag;
+            slot.index = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(vertex);
+            ++m_Count;
+            return slot.index;
+        }
+        if (slot.tag == tag && vertices[slot.index] == vertex)
+            return slot.index;
+
+        slotIndex = (slotIndex + 1) & m_Mask;
+    }
+}
+
+void VertexDedupTable::DeduplicateParallel(const std::vector<Vertex3D>& corners, unsigned int numThreads,
+    std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices)
+{
+    numThreads = std::max(1u, numThreads);
+    const size_t numCorners = corners.size();
+    const size_t numShards  = size_t(numThreads) * 8; //more shards than threads to even out the work
+    auto shardOf = [numShards](uint64_t hash) { return static_cast<size_t>(((hash >> 32) * numShards) >> 32); };
+
+    //1. hash every corner and count how many corners each chunk sends to every shard
+    std::vector<uint64_t> vHashes(numCorners);
+    std::vector<size_t> vChunkShardOffsets(numThreads * numShards, 0);
+    ParallelChunks::Run(numCorners, numThreads, [&](size_t begin, size_t end, unsigned int chunk)
+        {
+            size_t* pCounts = &vChunkShardOffsets[chunk * numShards];
+            for (size_t corner{ begin }; corner < end; ++corner)
+            {
+                vHashes[corner] = Hash(corners[corner]);
+                ++pCounts[shardOf(vHashes[corner])];
+            }
+        });
+
+    //2. turn the counts into offsets ordered by (shard, chunk) and scatter, so every shard keeps the corners in original order
+    std::vector<size_t> vShardBegin(numShards + 1, 0);
+    size_t offset{ 0 };
+    for (size_t shard{}; shard < numShards; ++shard)
+    {
+        vShardBegin[shard] = offset;
+        for (unsigned int chunk{}; chunk < numThreads; ++chunk)
+        {
+            const size_t count = vChunkShardOffsets[chunk * numShards + shard];
+            vChunkShardOffsets[chunk * numShards + shard] = offset;
+            offset += count;
+        }
+    }
+    vShardBegin[numShards] = offset;
+
+    std::vector<uint32_t> vShardCorners(numCorners);
+    ParallelChunks::Run(numCorners, numThreads, [&](size_t begin, size_t end, unsigned int chunk)
+        {
+            size_t* pOffsets = &vChunkShardOffsets[chunk * numShards];
+            for (size_t corner{ begin }; corner < end; ++corner)
+                vShardCorners[pOffsets[shardOf(vHashes[corner])]++] = static_cast<uint32_t>(corner);
+        });
+
+    //3. dedup every shard on its own, for every corner remember the first corner that has the same vertex
+    std::vector<uint32_t> vFirstCorner(numCorners);
+    ParallelChunks::Run(numShards, numThreads, [&](size_t shardBegin, size_t shardEnd, unsigned int)
+        {
+            std::vector<Slot> vSlots;
+            for (size_t shard{ shardBegin }; shard < shardEnd; ++shard)
+            {
+                const size_t count = vShardBegin[shard + 1] - vShardBegin[shard];
+                const size_t capacity = nextPowerOfTwo(count + count / 3 + 1);
+                const size_t mask = capacity - 1;
+                vSlots.assign(capacity, Slot{ 0, EmptySlot });
+
+                for (size_t i{ vShardBegin[shard] }; i < vShardBegin[shard + 1]; ++i)
+                {
+                    const uint32_t corner = vShardCorners[i];
+                    const uint32_t tag    = static_cast<uint32_t>(vHashes[corner] >> 32);
+
+                    size_t slotIndex = static_cast<size_t>(vHashes[corner]) & mask;
+                    while (true)
+                    {
+                        Slot& slot = vSlots[slotIndex];
+                        if (slot.index == EmptySlot)
+                        {
+                            slot = Slot{ tag, corner };
+                            vFirstCorner[corner] = corner;
+                            break;
+                        }
+                        if (slot.tag == tag && corners[slot.index] == corners[corner])
+                        {
+                            vFirstCorner[corner] = slot.index;
+                            break;
+                        }
+                        slotIndex = (slotIndex + 1) & mask;
+                    }
+                }
+            }
+        });
+
+    //4. first occurrences get their final index in corner order, which is the order the serial pass appends them in
+    std::vector<size_t> vChunkUniqueBase(numThreads + 1, 0);
+    ParallelChunks::Run(numCorners, numThreads, [&](size_t begin, size_t end, unsigned int chunk)
+        {
+            size_t count{ 0 };
+            for (size_t corner{ begin }; corner < end; ++corner)
+                count += vFirstCorner[corner] == corner;
+            vChunkUniqueBase[chunk + 1] = count;
+        });
+    for (unsigned int chunk{}; chunk < numThreads; ++chunk)
+        vChunkUniqueBase[chunk + 1] += vChunkUniqueBase[chunk];
+
+    //the shard lists are not needed anymore, reuse them as first corner -> vertex index
+    std::vector<uint32_t>& vVertexIndex = vShardCorners;
+    vertices.resize(vChunkUniqueBase[numThreads]);
+    ParallelChunks::Run(numCorners, numThreads, [&](size_t begin, size_t end, unsigned int chunk)
+        {
+            size_t vertexIndex = vChunkUniqueBase[chunk];
+            for (size_t corner{ begin }; corner < end; ++corner)
+            {
+                if (vFirstCorner[corner] != corner)
+                    continue;
+                vVertexIndex[corner] = static_cast<uint32_t>(vertexIndex);
+                vertices[vertexIndex++] = corners[corner];
+            }
+        });
+
+    //5. every corner points at the vertex off its first occurrence
+    indices.resize(numCorners);
+    ParallelChunks::Run(numCorners, numThreads, [&](size_t begin, size_t end, unsigned int)
+        {
+            for (size_t corner{ begin }; corner < end; ++corner)
+                indices[corner] = vVertexIndex[vFirstCorner[corner]];
+        });
+}
+
+uint64_t VertexDedupTable::Hash(const Vertex3D& vertex)
+{
+    const uint64_t words[4] =
+    {
+        packPair(vertex.pos.x, vertex.pos.y),
+        packPair(vertex.pos.z, vertex.normal.x),
+        packPair(vertex.normal.y, vertex.normal.z),
+        packPair(vertex.texcoord.x, vertex.texcoord.y)
+    };
+
+    uint64_t hash{ 0x9E3779B97F4A7C15ULL };
+    for (uint64_t word : words)
+    {
+        hash ^= mix64(word);
+        hash = (hash << 27) | (hash >> 37);
+        hash *= 0x100000001B3ULL;
+    }
+    return mix64(hash);
+}
+
+void VertexDedupTable::grow(const std::vector<Vertex3D>& vertices)
+{
+    std::vector<Slot> vOldSlots = std::move(m_vSlots);
+    m_vSlots.assign(vOldSlots.size() * 2, Slot{ 0, EmptySlot });
+    m_Mask = m_vSlots.size() - 1;
+
+    for (const Slot& oldSlot : vOldSlots)
+    {
+        if (oldSlot.index == EmptySlot)
+            continue;
+
+        size_t slotIndex = static_cast<size_t>(Hash(vertices[oldSlot.index])) & m_Mask;
+        while (m_vSlots[slotIndex].index != EmptySlot)
+            slotIndex = (slotIndex + 1) & m_Mask;
+        m_vSlots[slotIndex] = oldSlot;
+    }
+}
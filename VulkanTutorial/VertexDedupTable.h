@@ -0,0 +1,41 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+//Flat open addressing table (linear probing) used to deduplicate vertices while loading a model
+//Slots only store a hash tag and the index into the vertex vector, so there is no heap node per vertex
+class VertexDedupTable
+{
+public:
+    //expectedVertices is an upper bound, the index count off the mesh works fine
+    explicit VertexDedupTable(size_t expectedVertices);
+
+    //Looks vertex up and appends it to vertices if it is not in there yet (one probe sequence for both)
+    //returns the index off the vertex inside vertices
+    uint32_t Insert(const Vertex3D& vertex, std::vector<Vertex3D>& vertices);
+
+    //Deduplicates corners (one vertex per face corner) over numThreads threads by splitting them in hash shards
+    //Output is exactly the same as calling Insert() for every corner in order, whatever the thread count
+    static void DeduplicateParallel(const std::vector<Vertex3D>& corners, unsigned int numThreads,
+        std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices);
+
+    //64 bit hash off the float bit patterns, -0.0 is hashed as 0.0 so it agrees with Vertex3D::operator==
+    static uint64_t Hash(const Vertex3D& vertex);
+
+private:
+    struct Slot
+    {
+        uint32_t tag;   //upper half off the hash, cheap reject before comparing vertices
+        uint32_t index; //EmptySlot when unused
+    };
+    static constexpr uint32_t EmptySlot{ 0xFFFFFFFF };
+
+    std::vector<Slot> m_vSlots;
+    size_t m_Mask{ 0 };
+    size_t m_Count{ 0 };
+
+    void grow(const std::vector<Vertex3D>& vertices);
+};
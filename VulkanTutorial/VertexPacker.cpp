@@ -0,0 +1,123 @@
+#include "VertexPacker.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
+#include <cmath>
+
+
+static int16_t toSnorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(glm::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+static int8_t toSnorm8(float value)
+{
+    return static_cast<int8_t>(std::lround(glm::clamp(value, -1.f, 1.f) * 127.f));
+}
+
+
+std::vector<Vertex3DPacked> VertexPacker::Pack(const Vertex3D* pVertices, size_t vertexCount, const glm::vec3& center, float scale)
+{
+    const float inverseScale = scale > 0.f ? 1.f / scale : 0.f;
+
+    std::vector<Vertex3DPacked> vPacked(vertexCount);
+    for (size_t i{}; i < vertexCount; ++i)
+    {
+        const Vertex3D& vertex = pVertices[i];
+        Vertex3DPacked& packed = vPacked[i];
+
+        const glm::vec3 position = (vertex.pos - center) * inverseScale;
+        packed.pos[0] = toSnorm16(position.x);
+        packed.pos[1] = toSnorm16(position.y);
+        packed.pos[2] = toSnorm16(position.z);
+        packed.pos[3] = 0;
+
+        const glm::vec2 normal = OctEncode(vertex.normal);
+        packed.normal[0] = toSnorm16(normal.x);
+        packed.normal[1] = toSnorm16(normal.y);
+
+        packed.texcoord[0] = FloatToHalf(vertex.texcoord.x);
+        packed.texcoord[1] = FloatToHalf(vertex.texcoord.y);
+    }
+    return vPacked;
+}
+
+std::vector<Vertex2DPacked> VertexPacker::Pack(const std::vector<Vertex2D>& vertices)
+{
+    std::vector<Vertex2DPacked> vPacked(vertices.size());
+    for (size_t i{}; i < vertices.size(); ++i)
+    {
+        const Vertex2D& vertex = vertices[i];
+        Vertex2DPacked& packed = vPacked[i];
+
+        packed.pos[0] = FloatToHalf(vertex.pos.x);
+        packed.pos[1] = FloatToHalf(vertex.pos.y);
+
+        packed.normal[0] = toSnorm8(vertex.normal.x);
+        packed.normal[1] = toSnorm8(vertex.normal.y);
+        packed.normal[2] = toSnorm8(vertex.normal.z);
+        packed.normal[3] = 0;
+
+        packed.texcoord[0] = FloatToHalf(vertex.texcoord.x);
+        packed.texcoord[1] = FloatToHalf(vertex.texcoord.y);
+    }
+    return vPacked;
+}
+
+glm::mat4 VertexPacker::GetDequantizeMatrix(const glm::vec3& center, float scale)
+{
+    return glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(scale));
+}
+
+uint16_t VertexPacker::FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const int32_t  exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa       = bits & 0x7FFFFF;
+
+    if ((bits & 0x7FFFFFFF) >= 0x7F800000) //inf and nan
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7C00);
+
+    if (exponent <= 0)
+    {
+        //subnormal half
+        if (exponent < -10)
+            return static_cast<uint16_t>(sign);
+
+        mantissa |= 0x800000;
+        const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half; //a carry into the exponent is still the right result
+    return static_cast<uint16_t>(sign | half);
+}
+
+glm::vec2 VertexPacker::OctEncode(const glm::vec3& normal)
+{
+    const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length <= 0.f)
+        return glm::vec2{ 0.f, 0.f };
+
+    const glm::vec3 n = normal / length;
+    if (n.z >= 0.f)
+        return glm::vec2{ n.x, n.y };
+
+    //fold the lower half over the diagonals
+    return glm::vec2{
+        (1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f),
+        (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f)
+    };
+}
@@ -0,0 +1,24 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+//Converts float vertices to the packed layouts off VertexFormat right before they get uploaded
+class VertexPacker
+{
+public:
+    //positions are stored as (pos - center) / scale, scale being the largest half extent off the mesh
+    static std::vector<Vertex3DPacked> Pack(const Vertex3D* pVertices, size_t vertexCount, const glm::vec3& center, float scale);
+    static std::vector<Vertex2DPacked> Pack(const std::vector<Vertex2D>& vertices);
+
+    //turns the snorm positions back into model space, goes on the right off the model transform
+    //the scale is the same on every axis so the normals only need the normalize the shader already does
+    static glm::mat4 GetDequantizeMatrix(const glm::vec3& center, float scale);
+
+    //round to nearest even, overflow becomes infinity
+    static uint16_t FloatToHalf(float value);
+    //octahedral mapping off a unit vector to [-1, 1]^2 (decoded by octDecode in shaderPacked.vert)
+    static glm::vec2 OctEncode(const glm::vec3& normal);
+};
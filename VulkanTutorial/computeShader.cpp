@@ -9,6 +9,6 @@ void ParticleEffect::Init()
 		m_pOwner->createBuffer(bufferSize,
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			m_Buffer[i], m_BufferMemory[i]);
+			m_Buffer[i], m_BufferAllocation[i], MemoryCategory::Other);
 	}
 }
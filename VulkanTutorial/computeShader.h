@@ -2,6 +2,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <array>
+#include "DeviceAllocator.h"
 
 class Game;
 
@@ -16,5 +17,5 @@ private:
 	static const int m_NumOfParticles{ 100 };
 	Game* m_pOwner;
 	std::array<VkBuffer, m_NumOfParticles> m_Buffer;
-	std::array<VkDeviceMemory, m_NumOfParticles> m_BufferMemory;
+	std::array<DeviceAllocation, m_NumOfParticles> m_BufferAllocation;
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 glslc.exe shader.vert -o vert.spv
 glslc.exe shader2D.vert -o vert2D.spv
+glslc.exe shaderPacked.vert -o vertPacked.spv
 glslc.exe shader.frag -o frag.spv
 pause
\ No newline at end of file
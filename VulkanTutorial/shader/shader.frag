@@ -1,12 +1,19 @@
 #version 450
-
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
+//every texture off the scene, the draw picks one with textureIndex (same for the whole draw, so no nonuniformEXT)
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(binding = 2) uniform objectData
+{
+    mat4 model;
+    uint textureIndex;
+}
+obj;
 
 void main() {
     const vec3 lightDirection = normalize(vec3(0.0, -1.0, 1.0));
@@ -15,7 +22,7 @@ void main() {
     float diff = max(dot(fragNormal, lightDirection), 0.2);
 
     // Simple diffuse lighting
-    vec3 diffuse = diff * texture(texSampler,fragTexCoord ).xyz; // Assuming white light
+    vec3 diffuse = diff * texture(textures[obj.textureIndex], fragTexCoord).xyz; // Assuming white light
 
     // Output color
     outColor =  vec4(diffuse,1.0);
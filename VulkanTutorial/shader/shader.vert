@@ -7,11 +7,12 @@ layout(binding = 0) uniform uniformBufferObject
     mat4 proj;
 }
 ubo;
-layout(push_constant) uniform pushConstant
+layout(binding = 2) uniform objectData
 {
     mat4 model;
+    uint textureIndex;
 }
-ps;
+obj;
 
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
@@ -22,8 +23,8 @@ layout(location = 1) out vec2 fragTexCoord;
 
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * ps.model * vec4(inPosition, 1.0);
-    vec4 tNormal =  ps.model * vec4(inNormal,0);
+    gl_Position = ubo.proj * ubo.view * ubo.model * obj.model * vec4(inPosition, 1.0);
+    vec4 tNormal =  obj.model * vec4(inNormal,0);
     fragNormal = normalize(tNormal.xyz); // interpolation of normal attribute in fragment shader.
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
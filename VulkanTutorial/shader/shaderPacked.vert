@@ -0,0 +1,39 @@
+#version 450
+
+layout(binding = 0) uniform uniformBufferObject
+{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+}
+ubo;
+layout(binding = 2) uniform objectData
+{
+    mat4 model; //includes the dequantization off the positions (uniform scale)
+    uint textureIndex;
+}
+obj;
+
+//Vertex3DPacked: snorm16 position, octahedral snorm16 normal, half float uv
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec2 inNormal;
+layout (location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * ubo.model * obj.model * vec4(inPosition, 1.0);
+    vec4 tNormal =  obj.model * vec4(octDecode(inNormal),0);
+    fragNormal = normalize(tNormal.xyz); // interpolation of normal attribute in fragment shader.
+    fragTexCoord = inTexCoord;
+}